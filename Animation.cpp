@@ -0,0 +1,130 @@
+#include <cmath>
+#include <iostream>
+#include "Animation.h"
+
+int const AnimationClip::frame_at(float time) const
+{
+    int frame_count = (int)frames.size();
+    int index = 0;
+
+    if (inverse_frame_duration > 0.0f)
+    {
+        index = (int)(time * inverse_frame_duration);
+    }
+    else
+    {
+        while (index < frame_count - 1 && time >= frame_ends[index]) index++;
+    }
+
+    if (index >= frame_count) index = frame_count - 1;
+    if (index < 0) index = 0;
+
+    return frames[index];
+}
+
+int AnimationSystem::add_clip(const std::vector<int> &frames, const std::vector<float> &durations,
+                              AnimationLoopMode loop_mode, int cols, int rows)
+{
+    // frame_at indexes frames without checking, so every clip keeps at least one
+    if (frames.empty() || durations.size() != frames.size())
+    {
+        std::cout << "Animation: a clip needs at least one frame and one duration per frame; "
+                  << "showing cell 0 instead" << std::endl;
+        return add_clip(std::vector<int>(1, 0), std::vector<float>(1, 1.0f), loop_mode, cols, rows);
+    }
+
+    AnimationClip clip;
+    clip.frames = frames;
+    clip.loop_mode = loop_mode;
+    clip.cols = cols;
+    clip.rows = rows;
+
+    bool uniform = true;
+    for (int i = 0; i < (int)durations.size(); i++)
+    {
+        clip.length += durations[i];
+        clip.frame_ends.push_back(clip.length);
+        if (durations[i] != durations[0]) uniform = false;
+    }
+
+    if (uniform && clip.length > 0.0f)
+    {
+        clip.inverse_frame_duration = 1.0f / durations[0];
+    }
+
+    m_clips.push_back(clip);
+    return (int)m_clips.size() - 1;
+}
+
+int AnimationSystem::add_clip(const std::vector<int> &frames, float seconds_per_frame,
+                              AnimationLoopMode loop_mode, int cols, int rows)
+{
+    return add_clip(frames, std::vector<float>(frames.size(), seconds_per_frame), loop_mode, cols, rows);
+}
+
+int AnimationSystem::create_animator(int clip_id)
+{
+    m_clip_ids.push_back(clip_id);
+    m_times.push_back(0.0f);
+    m_rates.push_back(0.0f);
+    m_frames.push_back(m_clips[clip_id].frame_at(0.0f));
+
+    return (int)m_times.size() - 1;
+}
+
+void AnimationSystem::play(int animator, int clip_id)
+{
+    if (m_clip_ids[animator] == clip_id) return;
+
+    m_clip_ids[animator] = clip_id;
+    m_times[animator] = 0.0f;
+    m_frames[animator] = m_clips[clip_id].frame_at(0.0f);
+}
+
+void AnimationSystem::advance(float delta_time)
+{
+    int count = (int)m_times.size();
+    float* times = m_times.data();
+    const float* rates = m_rates.data();
+
+    // STEP 1: Advance every clock in one tight loop over contiguous floats so
+    //         the compiler can vectorise it.
+    for (int i = 0; i < count; i++)
+    {
+        times[i] += delta_time * rates[i];
+    }
+
+    // STEP 2: Wrap each clock according to its clip and resolve the frame.
+    //         The remainder is carried over instead of being reset to zero,
+    //         so frames no longer drift against the fixed timestep.
+    for (int i = 0; i < count; i++)
+    {
+        const AnimationClip &clip = m_clips[m_clip_ids[i]];
+        float time = times[i];
+        float sample_time = time;
+
+        if (clip.length > 0.0f)
+        {
+            switch (clip.loop_mode)
+            {
+            case LOOP_REPEAT:
+                if (time >= clip.length) time = fmodf(time, clip.length);
+                sample_time = time;
+                break;
+
+            case LOOP_ONCE:
+                if (time > clip.length) time = clip.length;
+                sample_time = time;
+                break;
+
+            case LOOP_PING_PONG:
+                if (time >= 2.0f * clip.length) time = fmodf(time, 2.0f * clip.length);
+                sample_time = time > clip.length ? 2.0f * clip.length - time : time;
+                break;
+            }
+        }
+
+        times[i] = time;
+        m_frames[i] = clip.frame_at(sample_time);
+    }
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <vector>
+
+enum AnimationLoopMode { LOOP_REPEAT, LOOP_ONCE, LOOP_PING_PONG };
+
+// A clip is shared, read-only data: which sprite-sheet cells to show and for
+// how long. Entities never own one, they only point at it through an animator.
+struct AnimationClip
+{
+    std::vector<int>   frames;     // sprite-sheet cell shown for each frame
+    std::vector<float> frame_ends; // running total of the frame durations
+    AnimationLoopMode  loop_mode = LOOP_REPEAT;
+    float length = 0.0f;
+    float inverse_frame_duration = 0.0f; // non-zero when every frame lasts the same time
+
+    int cols = 1;
+    int rows = 1;
+
+    int const frame_at(float time) const;
+};
+
+class AnimationSystem
+{
+private:
+    // ––––– SHARED CLIPS ––––– //
+    std::vector<AnimationClip> m_clips;
+
+    // ––––– PER-ANIMATOR STATE (SoA) ––––– //
+    std::vector<int>   m_clip_ids;
+    std::vector<float> m_times;
+    std::vector<float> m_rates;  // 0 pauses, 1 plays at normal speed
+    std::vector<int>   m_frames; // resolved sprite-sheet cell, refreshed by advance()
+
+public:
+    // ––––– CLIPS ––––– //
+    // A clip without frames, or without a duration for each, is replaced by
+    // one that holds cell 0, so the id returned is always valid
+    int add_clip(const std::vector<int> &frames, const std::vector<float> &durations,
+                 AnimationLoopMode loop_mode, int cols, int rows);
+    int add_clip(const std::vector<int> &frames, float seconds_per_frame,
+                 AnimationLoopMode loop_mode, int cols, int rows);
+
+    // ––––– ANIMATORS ––––– //
+    int  create_animator(int clip_id);
+    void play(int animator, int clip_id);
+    void advance(float delta_time);
+
+    // ––––– GETTERS ––––– //
+    const AnimationClip &get_clip(int animator) const { return m_clips[m_clip_ids[animator]]; };
+    int   const get_frame(int animator)         const { return m_frames[animator];              };
+    float const get_time(int animator)          const { return m_times[animator];               };
+    int   const get_animator_count()            const { return (int)m_times.size();             };
+
+    // ––––– SETTERS ––––– //
+    void set_rate(int animator, float rate) { m_rates[animator] = rate; };
+};
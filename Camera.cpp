@@ -0,0 +1,47 @@
+#include <algorithm>
+#include <cmath>
+#include "glm/gtc/matrix_transform.hpp"
+#include "Camera.h"
+
+void Camera::initialise(const glm::vec2 &half_size, const glm::vec2 &level_min, const glm::vec2 &level_max)
+{
+    m_half_size = half_size;
+    m_level_min = level_min;
+    m_level_max = level_max;
+    look_at(glm::vec2(0.0f));
+}
+
+glm::vec2 const Camera::clamp_to_level(const glm::vec2 &position) const
+{
+    glm::vec2 clamped;
+
+    for (int axis = 0; axis < 2; axis++)
+    {
+        float low = m_level_min[axis] + m_half_size[axis];
+        float high = m_level_max[axis] - m_half_size[axis];
+
+        if (low > high) clamped[axis] = (m_level_min[axis] + m_level_max[axis]) * 0.5f;
+        else            clamped[axis] = std::min(std::max(position[axis], low), high);
+    }
+
+    return clamped;
+}
+
+void Camera::look_at(const glm::vec2 &target)
+{
+    m_position = clamp_to_level(target);
+    m_previous_position = m_position;
+}
+
+void Camera::follow(const glm::vec2 &target, float delta_time)
+{
+    // Closes the same share of the gap every second whatever the step size
+    float blend = 1.0f - expf(-m_follow_rate * delta_time);
+
+    m_position = clamp_to_level(m_position + (target - m_position) * blend);
+}
+
+glm::mat4 Camera::view_matrix(const glm::vec2 &position)
+{
+    return glm::translate(glm::mat4(1.0f), glm::vec3(-position, 0.0f));
+}
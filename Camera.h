@@ -0,0 +1,40 @@
+#pragma once
+
+#include "glm/mat4x4.hpp"
+#include "glm/vec2.hpp"
+
+// Follows a target through a level that may be many screens across. The
+// camera eases towards the target rather than snapping to it, and never
+// shows anything outside the level bounds; on an axis where the level is
+// smaller than the view it simply sits in the middle.
+//
+// It moves in fixed steps with the simulation and keeps its position from
+// the step before, so the renderer can interpolate it like any entity.
+class Camera
+{
+private:
+    glm::vec2 m_position = glm::vec2(0.0f);
+    glm::vec2 m_previous_position = glm::vec2(0.0f);
+    glm::vec2 m_half_size = glm::vec2(1.0f);    // half the visible area, in world units
+    glm::vec2 m_level_min = glm::vec2(0.0f);
+    glm::vec2 m_level_max = glm::vec2(0.0f);
+    float m_follow_rate = 4.0f; // per second; higher catches up faster
+
+    glm::vec2 const clamp_to_level(const glm::vec2 &position) const;
+
+public:
+    void initialise(const glm::vec2 &half_size, const glm::vec2 &level_min, const glm::vec2 &level_max);
+
+    // Jumps straight to the target, with no easing and nothing to interpolate
+    void look_at(const glm::vec2 &target);
+    void follow(const glm::vec2 &target, float delta_time);
+    void save_previous_state() { m_previous_position = m_position; };
+
+    void set_follow_rate(float rate) { m_follow_rate = rate; };
+
+    glm::vec2 const get_position()          const { return m_position;          };
+    glm::vec2 const get_previous_position() const { return m_previous_position; };
+    glm::vec2 const get_half_size()         const { return m_half_size;         };
+
+    static glm::mat4 view_matrix(const glm::vec2 &position);
+};
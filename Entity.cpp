@@ -11,6 +11,9 @@
 #include "glm/mat4x4.hpp"
 #include "glm/gtc/matrix_transform.hpp"
 #include "ShaderProgram.h"
+#include "SpriteBatch.h"
+#include "RenderSnapshot.h"
+#include "Animation.h"
 #include "Entity.h"
 
 Entity::Entity()
@@ -25,50 +28,27 @@ Entity::Entity()
     m_movement = glm::vec3(0.0f);
     m_speed = 0;
     m_model_matrix = glm::mat4(1.0f);
+    m_previous_model_matrix = glm::mat4(1.0f);
     
 }
 
 Entity::~Entity()
 {
-    delete[] m_animation_up;
-    delete[] m_animation_down;
-    delete[] m_animation_left;
-    delete[] m_animation_right;
-    delete[] m_walking;
 }
 
-void Entity::draw_sprite_from_texture_atlas(ShaderProgram* program, GLuint texture_id, int index)
+void Entity::draw_sprite_from_texture_atlas(RenderSnapshot* snapshot, GLuint texture_id, int index)
 {
-    float u_coord = (float)(index % m_animation_cols) / (float)m_animation_cols;
-    float v_coord = (float)(index / m_animation_cols) / (float)m_animation_rows;
+    const AnimationClip &clip = m_animation->get_clip(m_animator);
 
-    float width = 1.0f / (float)m_animation_cols;
-    float height = 1.0f / (float)m_animation_rows;
+    // The sprite sheet may be one region of a bigger atlas
+    float width = (m_uv_rect.z - m_uv_rect.x) / (float)clip.cols;
+    float height = (m_uv_rect.w - m_uv_rect.y) / (float)clip.rows;
 
-    float tex_coords[] =
-    {
-        u_coord, v_coord + height, u_coord + width, v_coord + height, u_coord + width, v_coord,
-        u_coord, v_coord + height, u_coord + width, v_coord, u_coord, v_coord
-    };
-
-    float vertices[] =
-    {
-        -0.5, -0.5, 0.5, -0.5,  0.5, 0.5,
-        -0.5, -0.5, 0.5,  0.5, -0.5, 0.5
-    };
-
-    glBindTexture(GL_TEXTURE_2D, texture_id);
-
-    glVertexAttribPointer(program->get_position_attribute(), 2, GL_FLOAT, false, 0, vertices);
-    glEnableVertexAttribArray(program->get_position_attribute());
+    float u_coord = m_uv_rect.x + (float)(index % clip.cols) * width;
+    float v_coord = m_uv_rect.y + (float)(index / clip.cols) * height;
 
-    glVertexAttribPointer(program->get_tex_coordinate_attribute(), 2, GL_FLOAT, false, 0, tex_coords);
-    glEnableVertexAttribArray(program->get_tex_coordinate_attribute());
-
-    glDrawArrays(GL_TRIANGLES, 0, 6);
-
-    glDisableVertexAttribArray(program->get_position_attribute());
-    glDisableVertexAttribArray(program->get_tex_coordinate_attribute());
+    snapshot->add_sprite(texture_id, m_previous_model_matrix, m_model_matrix, glm::vec4(u_coord, v_coord, u_coord + width, v_coord + height),
+        m_tint);
 }
 
 
@@ -84,24 +64,11 @@ void Entity::update(float delta_time, Entity* collidable_entities, int collidabl
     m_collided_right = false;
 
     //  ANIMATION  //
-    if (m_animation_indices != NULL)
+    // The clock itself is advanced for every animator at once by
+    // AnimationSystem::advance; here we only decide whether ours is running.
+    if (m_animation != NULL && m_animator >= 0)
     {
-        if (glm::length(m_movement) != 0)
-        {
-            m_animation_time += delta_time;
-            float frames_per_second = (float)1 / SECONDS_PER_FRAME;
-
-            if (m_animation_time >= frames_per_second)
-            {
-                m_animation_time = 0.0f;
-                m_animation_index++;
-
-                if (m_animation_index >= m_animation_frames)
-                {
-                    m_animation_index = 0;
-                }
-            }
-        }
+        m_animation->set_rate(m_animator, glm::length(m_movement) != 0 ? 1.0f : 0.0f);
     }
 
     //  GRAVITY  //
@@ -215,32 +182,22 @@ void const Entity::check_collision_x(Entity* collidable_entities, int collidable
     }
 }
 
-void Entity::render(ShaderProgram* program)
+void Entity::save_previous_state()
 {
-    if (!m_is_active) return;
+    m_previous_model_matrix = m_model_matrix;
+}
 
-    program->set_model_matrix(m_model_matrix);
+void Entity::render(RenderSnapshot* snapshot)
+{
+    if (!m_is_active) return;
 
-    if (m_animation_indices != NULL)
+    if (m_animation != NULL && m_animator >= 0)
     {
-        draw_sprite_from_texture_atlas(program, m_texture_id, m_animation_indices[m_animation_index]);
+        draw_sprite_from_texture_atlas(snapshot, m_texture_id, m_animation->get_frame(m_animator));
         return;
     }
 
-    float vertices[] = { -0.5, -0.5, 0.5, -0.5, 0.5, 0.5, -0.5, -0.5, 0.5, 0.5, -0.5, 0.5 };
-    float tex_coords[] = { 0.0,  1.0, 1.0,  1.0, 1.0, 0.0,  0.0,  1.0, 1.0, 0.0,  0.0, 0.0 };
-
-    glBindTexture(GL_TEXTURE_2D, m_texture_id);
-
-    glVertexAttribPointer(program->get_position_attribute(), 2, GL_FLOAT, false, 0, vertices);
-    glEnableVertexAttribArray(program->get_position_attribute());
-    glVertexAttribPointer(program->get_tex_coordinate_attribute(), 2, GL_FLOAT, false, 0, tex_coords);
-    glEnableVertexAttribArray(program->get_tex_coordinate_attribute());
-
-    glDrawArrays(GL_TRIANGLES, 0, 6);
-
-    glDisableVertexAttribArray(program->get_position_attribute());
-    glDisableVertexAttribArray(program->get_tex_coordinate_attribute());
+    snapshot->add_sprite(m_texture_id, m_previous_model_matrix, m_model_matrix, m_uv_rect, m_tint);
 }
 
 bool const Entity::check_collision(Entity* other) const
@@ -5,12 +5,6 @@ class Entity
 private:
     bool m_is_active = true;
 
-    // ––––– ANIMATION ––––– //
-    int* m_animation_right = NULL; // move to the right
-    int* m_animation_left = NULL; // move to the left
-    int* m_animation_up = NULL; // move upwards
-    int* m_animation_down = NULL; // move downwards
-
     // ––––– PHYSICS (GRAVITY) ––––– //
     glm::vec3 m_position;
     glm::vec3 m_velocity;
@@ -27,7 +21,6 @@ private:
 
 public:
     // ––––– STATIC ATTRIBUTES ––––– //
-    static const int SECONDS_PER_FRAME = 4;
     static const int LEFT = 0,
         RIGHT = 1,
         UP = 2,
@@ -36,6 +29,9 @@ public:
     // ––––– SETUP AND RENDERING ––––– //
     GLuint m_texture_id;
     glm::mat4 m_model_matrix;
+    glm::mat4 m_previous_model_matrix; // as of the start of the last fixed step, for interpolation
+    glm::vec4 m_tint = glm::vec4(1.0f);
+    glm::vec4 m_uv_rect = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f); // where our image sits in m_texture_id
     EntityType m_type;
 
     // ––––– TRANSLATIONS ––––– //
@@ -44,13 +40,9 @@ public:
     glm::vec3 m_scale;
 
     // ––––– ANIMATIONS ––––– //
-    int** m_walking = new int* [4] { m_animation_left, m_animation_right, m_animation_up, m_animation_down };
-    int* m_animation_indices = NULL;
-    int m_animation_frames = 0;
-    int m_animation_index = 0;
-    float m_animation_time = 0.0f;
-    int m_animation_cols = 0;
-    int m_animation_rows = 0;
+    // Clip and clock live in the shared AnimationSystem; we only keep a handle
+    AnimationSystem* m_animation = NULL;
+    int m_animator = -1;
 
     // ––––– PHYSICS (JUMPING) ––––– //
     bool m_is_jumping = false;
@@ -66,9 +58,10 @@ public:
     Entity();
     ~Entity();
 
-    void draw_sprite_from_texture_atlas(ShaderProgram* program, GLuint texture_id, int index);
+    void draw_sprite_from_texture_atlas(RenderSnapshot* snapshot, GLuint texture_id, int index);
+    void save_previous_state();
     void update(float delta_time, Entity* collidable_entities, int collidable_entity_count);
-    void render(ShaderProgram* program);
+    void render(RenderSnapshot* snapshot);
 
     void const check_collision_y(Entity* collidable_entities, int collidable_entity_count);
     void const check_collision_x(Entity* collidable_entities, int collidable_entity_count);
@@ -86,6 +79,7 @@ public:
     glm::vec3 const get_movement()     const { return m_movement; };
     glm::vec3 const get_velocity()     const { return m_velocity; };
     glm::vec3 const get_acceleration() const { return m_acceleration; };
+    glm::vec3 const get_scale()        const { return m_scale; };
     int       const get_width()        const { return m_width; };
     int       const get_height()       const { return m_height; };
     bool const has_object_won() const { return win_game; }
@@ -101,6 +95,7 @@ public:
     void const set_width(float new_width) { m_width = new_width; };
     void const set_height(float new_height) { m_height  = new_height; };
     void const set_scale(glm::vec3 new_scale) { m_scale = new_scale; }
+    void const set_texture(GLuint texture_id, glm::vec4 uv_rect) { m_texture_id = texture_id; m_uv_rect = uv_rect; }
     void const set_dimensions(glm::vec3 new_scale) {
         m_scale = new_scale;
         m_height = new_scale.y;
@@ -0,0 +1,369 @@
+#define GL_SILENCE_DEPRECATION
+
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include "GLExtensions.h"
+#include "GLState.h"
+#include "FrameCapture.h"
+
+bool FrameCapture::initialise(int width, int height, const char* filepath_pattern)
+{
+    m_width = width;
+    m_height = height;
+    m_filepath_pattern = filepath_pattern != NULL ? filepath_pattern : "";
+
+    size_t length = m_filepath_pattern.size();
+    m_png = length >= 4 && m_filepath_pattern.compare(length - 4, 4, ".png") == 0;
+
+    if (!parse_pattern())
+    {
+        std::cout << "Capture: " << m_filepath_pattern << " must hold at most one %d, like frame_%05d.png" << std::endl;
+        return false;
+    }
+
+    for (int i = 0; i < PIXEL_BUFFER_COUNT; i++) m_pending_frame[i] = -1;
+    m_started_at = SDL_GetPerformanceCounter();
+
+    // Without a context frames only ever arrive through write_frame
+    if (!gl_has_context()) return true;
+
+    // STEP 1: A plain colour renderbuffer stands in for the window
+    glGenRenderbuffers(1, &m_colour_buffer);
+    glBindRenderbuffer(GL_RENDERBUFFER, m_colour_buffer);
+    glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+
+    glGenFramebuffers(1, &m_framebuffer);
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+    glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, m_colour_buffer);
+
+    if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+    {
+        std::cout << "Capture: framebuffer incomplete" << std::endl;
+        cleanup();
+        return false;
+    }
+
+    // STEP 2: One pixel buffer per frame in flight
+    glGenBuffers(PIXEL_BUFFER_COUNT, m_pixel_buffers);
+    for (int i = 0; i < PIXEL_BUFFER_COUNT; i++)
+    {
+        gl_bind_buffer(GL_PIXEL_PACK_BUFFER, m_pixel_buffers[i]);
+        glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr)width * height * 4, NULL, GL_STREAM_READ);
+    }
+    gl_bind_buffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    m_flipped.resize((size_t)width * height * 4);
+
+    return true;
+}
+
+// Splits the pattern around its one %d (or %0Nd), unescaping %%
+bool FrameCapture::parse_pattern()
+{
+    m_filepath_prefix.clear();
+    m_filepath_suffix.clear();
+    m_frame_digits = 0;
+
+    bool found = false;
+    for (size_t i = 0; i < m_filepath_pattern.size(); i++)
+    {
+        std::string &part = found ? m_filepath_suffix : m_filepath_prefix;
+        char c = m_filepath_pattern[i];
+
+        if (c != '%')
+        {
+            part += c;
+            continue;
+        }
+
+        if (i + 1 < m_filepath_pattern.size() && m_filepath_pattern[i + 1] == '%')
+        {
+            part += '%';
+            i++;
+            continue;
+        }
+
+        if (found) return false;
+
+        // An optional zero-padded width, then the d itself
+        size_t j = i + 1;
+        bool zero_pad = j < m_filepath_pattern.size() && m_filepath_pattern[j] == '0';
+        int width = 0;
+        while (j < m_filepath_pattern.size() && m_filepath_pattern[j] >= '0' && m_filepath_pattern[j] <= '9' && width < 100)
+        {
+            width = width * 10 + (m_filepath_pattern[j] - '0');
+            j++;
+        }
+
+        if (j >= m_filepath_pattern.size() || m_filepath_pattern[j] != 'd' || (width > 0 && !zero_pad)) return false;
+
+        m_frame_digits = width;
+        found = true;
+        i = j;
+    }
+
+    // No number in the pattern: put one before the extension, so frames do
+    // not all overwrite the same file
+    if (!found)
+    {
+        size_t dot = m_filepath_prefix.find_last_of('.');
+        size_t slash = m_filepath_prefix.find_last_of("/\\");
+        if (dot == std::string::npos || (slash != std::string::npos && dot < slash)) dot = m_filepath_prefix.size();
+
+        m_filepath_suffix = m_filepath_prefix.substr(dot);
+        m_filepath_prefix = m_filepath_prefix.substr(0, dot) + "_";
+    }
+
+    return true;
+}
+
+void FrameCapture::cleanup()
+{
+    if (!gl_has_context()) return;
+
+    for (int i = 0; i < PIXEL_BUFFER_COUNT; i++)
+    {
+        if (m_fences[i] != NULL) glDeleteSync(m_fences[i]);
+        m_fences[i] = NULL;
+        gl_delete_buffer(m_pixel_buffers[i]);
+        m_pixel_buffers[i] = 0;
+    }
+
+    if (m_framebuffer != 0) glDeleteFramebuffers(1, &m_framebuffer);
+    if (m_colour_buffer != 0) glDeleteRenderbuffers(1, &m_colour_buffer);
+    m_framebuffer = m_colour_buffer = 0;
+}
+
+void FrameCapture::bind()
+{
+    glBindFramebuffer(GL_FRAMEBUFFER, m_framebuffer);
+}
+
+void FrameCapture::capture()
+{
+    // No pattern: a pure rendering benchmark, nothing to read back
+    if (m_filepath_pattern.empty())
+    {
+        m_frames_captured++;
+        return;
+    }
+
+    int slot = m_frames_captured % PIXEL_BUFFER_COUNT;
+
+    // The buffer's previous frame has had PIXEL_BUFFER_COUNT - 1 frames to land
+    write_pending(slot);
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_framebuffer);
+    gl_bind_buffer(GL_PIXEL_PACK_BUFFER, m_pixel_buffers[slot]);
+    glReadPixels(0, 0, m_width, m_height, GL_RGBA, GL_UNSIGNED_BYTE, (void*)0);
+    gl_bind_buffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    m_fences[slot] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    m_pending_frame[slot] = m_frames_captured++;
+}
+
+void FrameCapture::finish()
+{
+    // Oldest first, so files appear in order
+    for (int i = 0; i < PIXEL_BUFFER_COUNT; i++) write_pending((m_frames_captured + i) % PIXEL_BUFFER_COUNT);
+}
+
+void FrameCapture::write_pending(int slot)
+{
+    if (m_pending_frame[slot] < 0) return;
+
+    // Normally long signalled; waiting here only happens if the GPU is far behind
+    glClientWaitSync(m_fences[slot], GL_SYNC_FLUSH_COMMANDS_BIT, GL_TIMEOUT_IGNORED);
+    glDeleteSync(m_fences[slot]);
+    m_fences[slot] = NULL;
+
+    Uint64 write_start = SDL_GetPerformanceCounter();
+
+    gl_bind_buffer(GL_PIXEL_PACK_BUFFER, m_pixel_buffers[slot]);
+    const unsigned char* pixels = (const unsigned char*)glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0,
+        (GLsizeiptr)m_width * m_height * 4, GL_MAP_READ_BIT);
+
+    if (pixels != NULL)
+    {
+        size_t row_size = (size_t)m_width * 4;
+        for (int y = 0; y < m_height; y++)
+        {
+            memcpy(&m_flipped[y * row_size], &pixels[(m_height - 1 - y) * row_size], row_size);
+        }
+        glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+
+        write_file(m_pending_frame[slot], m_flipped.data());
+    }
+    gl_bind_buffer(GL_PIXEL_PACK_BUFFER, 0);
+
+    m_pending_frame[slot] = -1;
+    m_write_time += SDL_GetPerformanceCounter() - write_start;
+}
+
+void FrameCapture::write_frame(const unsigned char* pixels)
+{
+    if (!m_filepath_pattern.empty())
+    {
+        Uint64 write_start = SDL_GetPerformanceCounter();
+        write_file(m_frames_captured, pixels);
+        m_write_time += SDL_GetPerformanceCounter() - write_start;
+    }
+
+    m_frames_captured++;
+}
+
+void FrameCapture::write_file(int frame, const unsigned char* pixels)
+{
+    std::string number = std::to_string(frame);
+    if ((int)number.size() < m_frame_digits) number.insert(0, m_frame_digits - number.size(), '0');
+
+    std::string filepath_string = m_filepath_prefix + number + m_filepath_suffix;
+    const char* filepath = filepath_string.c_str();
+
+    bool written = m_png ? write_png(filepath, pixels) : write_raw(filepath, pixels);
+    if (written) m_frames_written++;
+    else         std::cout << "Capture: unable to write " << filepath << std::endl;
+}
+
+bool FrameCapture::write_raw(const char* filepath, const unsigned char* pixels) const
+{
+    FILE* file = fopen(filepath, "wb");
+    if (file == NULL) return false;
+
+    bool written = fwrite(pixels, 4, (size_t)m_width * m_height, file) == (size_t)m_width * m_height;
+    fclose(file);
+
+    return written;
+}
+
+// ––––– PNG ––––– //
+// Just enough of the format to be read anywhere: one IDAT whose zlib stream
+// uses stored (uncompressed) deflate blocks, so no compressor is needed.
+// Files come out about as large as the raw frames.
+
+static unsigned int crc32_update(unsigned int crc, const unsigned char* data, size_t size)
+{
+    static unsigned int table[256];
+    static bool table_ready = false;
+
+    if (!table_ready)
+    {
+        for (unsigned int n = 0; n < 256; n++)
+        {
+            unsigned int c = n;
+            for (int k = 0; k < 8; k++) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            table[n] = c;
+        }
+        table_ready = true;
+    }
+
+    for (size_t i = 0; i < size; i++) crc = table[(crc ^ data[i]) & 0xFF] ^ (crc >> 8);
+    return crc;
+}
+
+static void put_big_endian(std::vector<unsigned char> &out, unsigned int value)
+{
+    out.push_back((unsigned char)(value >> 24));
+    out.push_back((unsigned char)(value >> 16));
+    out.push_back((unsigned char)(value >> 8));
+    out.push_back((unsigned char)value);
+}
+
+static void put_chunk(FILE* file, const char* type, const std::vector<unsigned char> &data)
+{
+    std::vector<unsigned char> header;
+    put_big_endian(header, (unsigned int)data.size());
+    header.insert(header.end(), type, type + 4);
+
+    unsigned int crc = crc32_update(0xFFFFFFFFu, (const unsigned char*)type, 4);
+    if (!data.empty()) crc = crc32_update(crc, data.data(), data.size());
+
+    std::vector<unsigned char> footer;
+    put_big_endian(footer, crc ^ 0xFFFFFFFFu);
+
+    fwrite(header.data(), 1, header.size(), file);
+    if (!data.empty()) fwrite(data.data(), 1, data.size(), file);
+    fwrite(footer.data(), 1, footer.size(), file);
+}
+
+bool FrameCapture::write_png(const char* filepath, const unsigned char* pixels) const
+{
+    FILE* file = fopen(filepath, "wb");
+    if (file == NULL) return false;
+
+    static const unsigned char SIGNATURE[8] = { 137, 'P', 'N', 'G', '\r', '\n', 26, '\n' };
+    fwrite(SIGNATURE, 1, sizeof(SIGNATURE), file);
+
+    // STEP 1: 8-bit RGBA, no interlacing
+    std::vector<unsigned char> header;
+    put_big_endian(header, m_width);
+    put_big_endian(header, m_height);
+    header.push_back(8); // bit depth
+    header.push_back(6); // colour type: RGBA
+    header.push_back(0);
+    header.push_back(0);
+    header.push_back(0);
+    put_chunk(file, "IHDR", header);
+
+    // STEP 2: Each scanline gets filter byte 0, then the zlib stream stores
+    //         them in blocks of at most 65535 bytes
+    size_t row_size = (size_t)m_width * 4;
+    std::vector<unsigned char> scanlines;
+    scanlines.reserve((row_size + 1) * m_height);
+    for (int y = 0; y < m_height; y++)
+    {
+        scanlines.push_back(0);
+        scanlines.insert(scanlines.end(), &pixels[y * row_size], &pixels[y * row_size] + row_size);
+    }
+
+    std::vector<unsigned char> image_data;
+    image_data.reserve(scanlines.size() + scanlines.size() / 65535 * 5 + 16);
+    image_data.push_back(0x78); // deflate, 32K window
+    image_data.push_back(0x01); // no preset dictionary, fastest
+
+    unsigned int adler_a = 1, adler_b = 0;
+    size_t offset = 0;
+    do
+    {
+        size_t block_size = scanlines.size() - offset;
+        if (block_size > 65535) block_size = 65535;
+        bool last_block = offset + block_size == scanlines.size();
+
+        image_data.push_back(last_block ? 1 : 0);
+        image_data.push_back((unsigned char)(block_size & 0xFF));
+        image_data.push_back((unsigned char)(block_size >> 8));
+        image_data.push_back((unsigned char)(~block_size & 0xFF));
+        image_data.push_back((unsigned char)((~block_size >> 8) & 0xFF));
+        image_data.insert(image_data.end(), scanlines.begin() + offset, scanlines.begin() + offset + block_size);
+
+        for (size_t i = offset; i < offset + block_size; i++)
+        {
+            adler_a = (adler_a + scanlines[i]) % 65521;
+            adler_b = (adler_b + adler_a) % 65521;
+        }
+
+        offset += block_size;
+    } while (offset < scanlines.size());
+
+    put_big_endian(image_data, (adler_b << 16) | adler_a);
+    put_chunk(file, "IDAT", image_data);
+    put_chunk(file, "IEND", std::vector<unsigned char>());
+
+    bool written = !ferror(file);
+    fclose(file);
+
+    return written;
+}
+
+void FrameCapture::report() const
+{
+    float seconds = (float)(SDL_GetPerformanceCounter() - m_started_at) / SDL_GetPerformanceFrequency();
+    if (seconds <= 0.0f || m_frames_captured == 0) return;
+
+    float write_seconds = (float)m_write_time / SDL_GetPerformanceFrequency();
+
+    std::cout << "Capture: " << m_frames_written << " of " << m_frames_captured << " frames written as "
+              << (m_png ? "PNG" : "raw RGBA") << ", " << m_frames_captured / seconds << " frames per second ("
+              << write_seconds / seconds * 100.0f << "% of the time spent writing files)" << std::endl;
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#ifdef _WINDOWS
+    #include <GL/glew.h>
+#endif
+#define GL_GLEXT_PROTOTYPES 1
+#include <SDL_opengl.h>
+#include <SDL.h>
+#include <string>
+#include <vector>
+
+// An offscreen render target whose frames are written out as numbered image
+// files: PNG when the pattern ends in .png, raw RGBA (top row first)
+// otherwise. The pattern marks where the frame number goes with one %d,
+// optionally zero-padded to a width as in "frames/frame_%05d.png"; "%%" is a
+// literal percent sign. A pattern without one gets the number appended before
+// its extension. The pattern is never handed to printf. Without a pattern
+// frames are drawn and counted but never read back.
+//
+// Readback goes through a ring of pixel buffer objects. glReadPixels into a
+// PBO returns at once, and a frame is only mapped and written out when its
+// buffer comes round again PIXEL_BUFFER_COUNT - 1 frames later, by which
+// point the GPU has long finished it. Rendering never waits on the copy.
+class FrameCapture
+{
+private:
+    static const int PIXEL_BUFFER_COUNT = 3;
+
+    int m_width = 0;
+    int m_height = 0;
+    GLuint m_framebuffer = 0;
+    GLuint m_colour_buffer = 0;
+
+    GLuint m_pixel_buffers[PIXEL_BUFFER_COUNT] = {};
+    GLsync m_fences[PIXEL_BUFFER_COUNT] = {};
+    int m_pending_frame[PIXEL_BUFFER_COUNT]; // frame number read into each buffer, -1 if none
+
+    std::string m_filepath_pattern;
+    std::string m_filepath_prefix;  // what comes before the frame number
+    std::string m_filepath_suffix;  // and after it
+    int m_frame_digits = 0;         // zero-padded to this many, if any
+    bool m_png = false;
+    std::vector<unsigned char> m_flipped; // GL rows run bottom-up, files top-down
+
+    int m_frames_captured = 0;
+    int m_frames_written = 0;
+    Uint64 m_started_at = 0;
+    Uint64 m_write_time = 0; // counter ticks spent encoding and writing files
+
+    bool parse_pattern();
+    void write_pending(int slot);
+    void write_file(int frame, const unsigned char* pixels);
+    bool write_png(const char* filepath, const unsigned char* pixels) const;
+    bool write_raw(const char* filepath, const unsigned char* pixels) const;
+
+public:
+    bool initialise(int width, int height, const char* filepath_pattern);
+    void cleanup();
+
+    // Makes the capture target the framebuffer everything is drawn into
+    void bind();
+    // Queues a readback of the frame just drawn and writes out older ones
+    void capture();
+    // Writes out every frame still in flight
+    void finish();
+
+    // Writes out a frame drawn on the CPU (RGBA, top row first) there and then
+    void write_frame(const unsigned char* pixels);
+
+    void report() const;
+};
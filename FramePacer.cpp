@@ -0,0 +1,89 @@
+#include <iostream>
+#include "FramePacer.h"
+
+void FramePacer::initialise(float target_rate, bool low_power)
+{
+    m_frequency = SDL_GetPerformanceFrequency();
+    m_period = target_rate > 0.0f ? (Uint64)(m_frequency / target_rate) : 0;
+    m_low_power = low_power;
+    m_spin_margin = low_power ? 0 : m_frequency * SPIN_MARGIN_MICROSECONDS / 1000000;
+
+    m_started_at = m_last_frame_at = SDL_GetPerformanceCounter();
+    m_next_deadline = m_started_at + m_period;
+    m_slept = m_spun = 0;
+    m_frames = m_frames_skipped = 0;
+}
+
+void FramePacer::wait_for_next_frame()
+{
+    m_frames++;
+
+    if (m_period == 0)
+    {
+        m_last_frame_at = SDL_GetPerformanceCounter();
+        return;
+    }
+
+    wait_until(m_next_deadline);
+
+    Uint64 now = SDL_GetPerformanceCounter();
+    m_last_frame_at = now;
+    m_next_deadline += m_period;
+
+    // Too far behind to ever catch up; drop the backlog
+    if (now > m_next_deadline) m_next_deadline = now + m_period;
+}
+
+void FramePacer::wait_until(Uint64 deadline)
+{
+    Uint64 now = SDL_GetPerformanceCounter();
+
+    // STEP 1: Sleep in whole milliseconds while the deadline is far enough
+    //         away that oversleeping cannot miss it
+    if (deadline > now + m_spin_margin)
+    {
+        Uint32 milliseconds = (Uint32)((deadline - now - m_spin_margin) * 1000 / m_frequency);
+
+        if (milliseconds > 0)
+        {
+            SDL_Delay(milliseconds);
+
+            Uint64 woke = SDL_GetPerformanceCounter();
+            m_slept += woke - now;
+            now = woke;
+        }
+    }
+
+    // STEP 2: Spin out the rest on the counter, unless we are saving power
+    if (m_low_power) return;
+
+    Uint64 spin_start = now;
+    while (now < deadline) now = SDL_GetPerformanceCounter();
+    m_spun += now - spin_start;
+}
+
+float const FramePacer::get_cpu_utilisation() const
+{
+    Uint64 elapsed = m_last_frame_at - m_started_at;
+    if (elapsed == 0) return 0.0f;
+
+    return 1.0f - (float)m_slept / elapsed;
+}
+
+void FramePacer::report(const char* name) const
+{
+    float seconds = (float)(m_last_frame_at - m_started_at) / m_frequency;
+    if (seconds <= 0.0f) return;
+
+    float target_rate = m_period > 0 ? (float)m_frequency / m_period : 0.0f;
+    int frames_shown = m_frames - m_frames_skipped;
+
+    std::cout << "Frame pacing (" << name << "): ";
+    if (target_rate > 0.0f) std::cout << target_rate << " Hz target, ";
+    else                    std::cout << "unpaced, ";
+    std::cout << m_frames / seconds << " Hz achieved";
+    if (m_frames_skipped > 0) std::cout << ", " << m_frames_skipped << " unchanged frames skipped (" << frames_shown << " drawn)";
+    std::cout << "; CPU " << get_cpu_utilisation() * 100.0f << "% busy, of which "
+              << (float)m_spun / m_frequency / seconds * 100.0f << "% spinning"
+              << (m_low_power ? " (low power)" : "") << std::endl;
+}
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <SDL.h>
+
+// Holds a loop to a target rate without burning a core. Each wait sleeps for
+// most of the time left, then spins the last stretch on the performance
+// counter, because a sleep can overshoot by a millisecond or more and miss
+// the deadline. In low-power mode it only sleeps and accepts the jitter.
+//
+// Deadlines advance by a fixed period, so a late frame is made up by the
+// next one rather than pushing every later frame back. A loop that falls
+// more than a period behind starts again from now instead of racing to
+// catch up.
+class FramePacer
+{
+private:
+    static const int SPIN_MARGIN_MICROSECONDS = 2000;
+
+    Uint64 m_frequency = 1;
+    Uint64 m_period = 0;       // counter ticks per frame; 0 means unpaced
+    Uint64 m_spin_margin = 0;
+    Uint64 m_next_deadline = 0;
+    bool m_low_power = false;
+
+    // ––––– STATISTICS ––––– //
+    Uint64 m_started_at = 0;
+    Uint64 m_last_frame_at = 0; // rates are measured up to here, not to shutdown
+    Uint64 m_slept = 0;        // counter ticks spent asleep
+    Uint64 m_spun = 0;         // counter ticks spent spinning
+    int m_frames = 0;
+    int m_frames_skipped = 0;
+
+public:
+    void initialise(float target_rate, bool low_power);
+
+    void wait_for_next_frame();
+    void wait_until(Uint64 deadline);
+
+    // For frames whose content matched the last one and were never drawn
+    void record_skipped_frame() { m_frames_skipped++; };
+
+    // Share of wall time this thread was not asleep, spinning included
+    float const get_cpu_utilisation() const;
+    void report(const char* name) const;
+
+    bool const is_low_power() const { return m_low_power; };
+};
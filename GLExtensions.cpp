@@ -0,0 +1,72 @@
+#define GL_SILENCE_DEPRECATION
+
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "GLExtensions.h"
+
+static bool g_has_context = true;
+
+void gl_set_no_context()
+{
+    g_has_context = false;
+}
+
+bool gl_has_context()
+{
+    return g_has_context;
+}
+
+bool gl_has_extension(const char* name)
+{
+    static std::vector<std::string> extensions;
+    static bool loaded = false;
+
+    if (!g_has_context) return false;
+
+    if (!loaded)
+    {
+        // Indexed queries are 3.0 and up, which GL_VERSION_REQUIRED guarantees
+        GLint count = 0;
+        glGetIntegerv(GL_NUM_EXTENSIONS, &count);
+
+        for (int i = 0; i < count; i++)
+        {
+            extensions.push_back((const char*)glGetStringi(GL_EXTENSIONS, i));
+        }
+
+        loaded = true;
+    }
+
+    for (int i = 0; i < (int)extensions.size(); i++)
+    {
+        if (extensions[i] == name) return true;
+    }
+
+    return false;
+}
+
+int gl_version()
+{
+    static int version = -1;
+
+    if (!g_has_context) return 0;
+
+    if (version < 0)
+    {
+        int major = 0, minor = 0;
+        const char* version_string = (const char*)glGetString(GL_VERSION);
+
+        // Desktop strings start with "4.5 ...", ES ones with "OpenGL ES 3.2 ..."
+        if (version_string != NULL)
+        {
+            const char* digits = version_string;
+            while (*digits != '\0' && (*digits < '0' || *digits > '9')) digits++;
+            sscanf(digits, "%d.%d", &major, &minor);
+        }
+
+        version = major * 10 + minor;
+    }
+
+    return version;
+}
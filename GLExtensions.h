@@ -0,0 +1,23 @@
+#pragma once
+
+#ifdef _WINDOWS
+    #include <GL/glew.h>
+#endif
+#define GL_GLEXT_PROTOTYPES 1
+#include <SDL_opengl.h>
+
+// Oldest context we run on, as gl_version() counts: the sprite batch needs
+// vertex arrays, mapped buffer ranges and base-vertex draws unconditionally.
+// Features past it are checked with gl_version() || gl_has_extension().
+const int GL_VERSION_REQUIRED = 32;
+
+// Queries about the current context. Both cache their answers on first use,
+// so a context must be current before they are called.
+bool gl_has_extension(const char* name);
+int  gl_version(); // major * 10 + minor, e.g. 33 for OpenGL 3.3
+
+// --software runs never create a context at all. Call this before anything
+// else touches GL; from then on the version is 0, no extension is present,
+// and everything that owns GL objects keeps to its CPU side.
+void gl_set_no_context();
+bool gl_has_context();
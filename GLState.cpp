@@ -0,0 +1,194 @@
+#define GL_SILENCE_DEPRECATION
+
+#include <map>
+#include "GLExtensions.h"
+#include "GLState.h"
+
+const int MAX_TEXTURE_UNITS = 16;
+const int MAX_BUFFER_TARGETS = 4;
+
+struct GLStateCache
+{
+    GLuint program_id = 0;
+    GLuint vertex_array = 0;
+    int active_unit = 0;
+    GLuint textures[MAX_TEXTURE_UNITS] = {};
+
+    GLenum buffer_targets[MAX_BUFFER_TARGETS] = { GL_ARRAY_BUFFER, GL_PIXEL_PACK_BUFFER,
+                                                  GL_PIXEL_UNPACK_BUFFER, GL_COPY_WRITE_BUFFER };
+    GLuint buffers[MAX_BUFFER_TARGETS] = {};
+
+    std::map<GLuint, unsigned int> enabled_attributes; // bitmask per VAO
+
+    GLStateStats frame_stats;
+    GLStateStats last_frame_stats;
+};
+
+static GLStateCache g_cache;
+
+void gl_count_call(bool skipped)
+{
+    if (skipped) g_cache.frame_stats.calls_skipped++;
+    else g_cache.frame_stats.calls_issued++;
+}
+
+void gl_use_program(GLuint program_id)
+{
+    bool skipped = g_cache.program_id == program_id;
+    gl_count_call(skipped);
+    if (skipped) return;
+
+    glUseProgram(program_id);
+    g_cache.program_id = program_id;
+}
+
+void gl_bind_texture(GLuint texture_id, int unit)
+{
+    bool skipped = g_cache.textures[unit] == texture_id;
+    gl_count_call(skipped);
+    if (skipped) return;
+
+    if (g_cache.active_unit != unit)
+    {
+        glActiveTexture(GL_TEXTURE0 + unit);
+        g_cache.active_unit = unit;
+    }
+
+    glBindTexture(GL_TEXTURE_2D, texture_id);
+    g_cache.textures[unit] = texture_id;
+}
+
+void gl_bind_vertex_array(GLuint vertex_array)
+{
+    bool skipped = g_cache.vertex_array == vertex_array;
+    gl_count_call(skipped);
+    if (skipped) return;
+
+    glBindVertexArray(vertex_array);
+    g_cache.vertex_array = vertex_array;
+}
+
+void gl_bind_buffer(GLenum target, GLuint buffer_id)
+{
+    for (int i = 0; i < MAX_BUFFER_TARGETS; i++)
+    {
+        if (g_cache.buffer_targets[i] != target) continue;
+
+        bool skipped = g_cache.buffers[i] == buffer_id;
+        gl_count_call(skipped);
+        if (skipped) return;
+
+        glBindBuffer(target, buffer_id);
+        g_cache.buffers[i] = buffer_id;
+        return;
+    }
+
+    gl_count_call(false);
+    glBindBuffer(target, buffer_id);
+}
+
+void gl_enable_vertex_attrib_array(GLuint index)
+{
+    // Missing attributes report location -1; let GL reject those as usual
+    if (index >= 32)
+    {
+        gl_count_call(false);
+        glEnableVertexAttribArray(index);
+        return;
+    }
+
+    unsigned int &enabled = g_cache.enabled_attributes[g_cache.vertex_array];
+    unsigned int bit = 1u << index;
+
+    bool skipped = (enabled & bit) != 0;
+    gl_count_call(skipped);
+    if (skipped) return;
+
+    glEnableVertexAttribArray(index);
+    enabled |= bit;
+}
+
+void gl_disable_vertex_attrib_array(GLuint index)
+{
+    // Missing attributes report location -1; let GL reject those as usual
+    if (index >= 32)
+    {
+        gl_count_call(false);
+        glDisableVertexAttribArray(index);
+        return;
+    }
+
+    unsigned int &enabled = g_cache.enabled_attributes[g_cache.vertex_array];
+    unsigned int bit = 1u << index;
+
+    bool skipped = (enabled & bit) == 0;
+    gl_count_call(skipped);
+    if (skipped) return;
+
+    glDisableVertexAttribArray(index);
+    enabled &= ~bit;
+}
+
+GLuint gl_gen_texture()
+{
+    static GLuint next_cpu_name = 1;
+
+    GLuint texture_id = 0;
+    if (gl_has_context()) glGenTextures(1, &texture_id);
+    else                  texture_id = next_cpu_name++;
+
+    return texture_id;
+}
+
+void gl_delete_program(GLuint program_id)
+{
+    if (!gl_has_context()) return;
+
+    glDeleteProgram(program_id);
+    if (g_cache.program_id == program_id) g_cache.program_id = 0;
+}
+
+void gl_delete_texture(GLuint texture_id)
+{
+    if (!gl_has_context()) return;
+
+    glDeleteTextures(1, &texture_id);
+
+    for (int i = 0; i < MAX_TEXTURE_UNITS; i++)
+    {
+        if (g_cache.textures[i] == texture_id) g_cache.textures[i] = 0;
+    }
+}
+
+void gl_delete_vertex_array(GLuint vertex_array)
+{
+    if (!gl_has_context()) return;
+
+    glDeleteVertexArrays(1, &vertex_array);
+
+    g_cache.enabled_attributes.erase(vertex_array);
+    if (g_cache.vertex_array == vertex_array) g_cache.vertex_array = 0;
+}
+
+void gl_delete_buffer(GLuint buffer_id)
+{
+    if (!gl_has_context()) return;
+
+    glDeleteBuffers(1, &buffer_id);
+
+    for (int i = 0; i < MAX_BUFFER_TARGETS; i++)
+    {
+        if (g_cache.buffers[i] == buffer_id) g_cache.buffers[i] = 0;
+    }
+}
+
+void gl_state_end_frame()
+{
+    g_cache.last_frame_stats = g_cache.frame_stats;
+    g_cache.frame_stats = GLStateStats();
+}
+
+const GLStateStats &gl_state_stats()
+{
+    return g_cache.last_frame_stats;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#ifdef _WINDOWS
+    #include <GL/glew.h>
+#endif
+#define GL_GLEXT_PROTOTYPES 1
+#include <SDL_opengl.h>
+
+// Shadow copy of the GL bindings we touch. Every bind goes through these
+// functions, which drop calls that would not change anything before they
+// reach the driver. Objects must be deleted through the wrappers below too,
+// otherwise a recycled name could be mistaken for one that is still bound.
+//
+// Enabled vertex attributes are VAO state, so they are tracked per VAO.
+// GL_ELEMENT_ARRAY_BUFFER is VAO state as well and is never cached.
+
+struct GLStateStats
+{
+    int calls_issued = 0;
+    int calls_skipped = 0;
+};
+
+void gl_use_program(GLuint program_id);
+void gl_bind_texture(GLuint texture_id, int unit = 0);
+void gl_bind_vertex_array(GLuint vertex_array);
+void gl_bind_buffer(GLenum target, GLuint buffer_id);
+void gl_enable_vertex_attrib_array(GLuint index);
+void gl_disable_vertex_attrib_array(GLuint index);
+
+// A new texture name. Without a context (see gl_set_no_context) it is just
+// the next unused number, so CPU copies of textures keep distinct names, and
+// the deletes below do nothing.
+GLuint gl_gen_texture();
+
+void gl_delete_program(GLuint program_id);
+void gl_delete_texture(GLuint texture_id);
+void gl_delete_vertex_array(GLuint vertex_array);
+void gl_delete_buffer(GLuint buffer_id);
+
+// For state caches that live elsewhere (e.g. uniform values in ShaderProgram)
+void gl_count_call(bool skipped);
+
+// Call once per frame; the counters of the frame just finished stay readable
+void gl_state_end_frame();
+const GLStateStats &gl_state_stats();
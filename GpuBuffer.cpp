@@ -0,0 +1,160 @@
+#define GL_SILENCE_DEPRECATION
+
+#include <vector>
+#include "GLExtensions.h"
+#include "GLState.h"
+#include "GpuBuffer.h"
+
+GLuint create_static_buffer(GLenum target, size_t size, const void* data)
+{
+    GLuint buffer_id;
+    glGenBuffers(1, &buffer_id);
+
+    // An index buffer binding belongs to whichever VAO is bound
+    if (target == GL_ELEMENT_ARRAY_BUFFER) gl_bind_vertex_array(0);
+
+    gl_bind_buffer(target, buffer_id);
+    glBufferData(target, size, data, GL_STATIC_DRAW);
+
+    return buffer_id;
+}
+
+GLuint create_quad_index_buffer(int max_quads)
+{
+    std::vector<GLushort> indices;
+    indices.reserve(max_quads * 6);
+
+    for (int i = 0; i < max_quads; i++)
+    {
+        GLushort first = (GLushort)(i * 4);
+        indices.insert(indices.end(), {
+            first, (GLushort)(first + 1), (GLushort)(first + 2),
+            first, (GLushort)(first + 2), (GLushort)(first + 3)
+            });
+    }
+
+    return create_static_buffer(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLushort), indices.data());
+}
+
+void StreamBuffer::initialise(GLenum target, size_t capacity)
+{
+    m_target = target;
+    m_capacity = capacity;
+    m_offset = 0;
+    m_unfenced_segment = 0;
+
+    glGenBuffers(1, &m_buffer_id);
+    gl_bind_buffer(m_target, m_buffer_id);
+
+    if (gl_version() >= 44 || gl_has_extension("GL_ARB_buffer_storage"))
+    {
+        GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+        glBufferStorage(m_target, m_capacity, NULL, flags);
+        m_persistent_pointer = (unsigned char*)glMapBufferRange(m_target, 0, m_capacity, flags);
+    }
+    else
+    {
+        glBufferData(m_target, m_capacity, NULL, GL_STREAM_DRAW);
+    }
+}
+
+void StreamBuffer::cleanup()
+{
+    for (int i = 0; i < SEGMENT_COUNT; i++)
+    {
+        if (m_segment_fences[i] != NULL) glDeleteSync(m_segment_fences[i]);
+        m_segment_fences[i] = NULL;
+    }
+
+    if (m_persistent_pointer != NULL)
+    {
+        gl_bind_buffer(m_target, m_buffer_id);
+        glUnmapBuffer(m_target);
+        m_persistent_pointer = NULL;
+    }
+
+    gl_delete_buffer(m_buffer_id);
+    m_buffer_id = 0;
+}
+
+void StreamBuffer::fence_segments(int first, int last)
+{
+    for (int i = first; i <= last; i++)
+    {
+        if (m_segment_fences[i] != NULL) glDeleteSync(m_segment_fences[i]);
+        m_segment_fences[i] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+    }
+}
+
+void StreamBuffer::wait_for_segments(int first, int last)
+{
+    const GLuint64 ONE_MILLISECOND = 1000000;
+
+    for (int i = first; i <= last; i++)
+    {
+        if (m_segment_fences[i] == NULL) continue;
+
+        while (glClientWaitSync(m_segment_fences[i], GL_SYNC_FLUSH_COMMANDS_BIT, ONE_MILLISECOND) == GL_TIMEOUT_EXPIRED);
+
+        glDeleteSync(m_segment_fences[i]);
+        m_segment_fences[i] = NULL;
+    }
+}
+
+void* StreamBuffer::reserve(size_t max_size, size_t alignment)
+{
+    size_t start = (m_offset + alignment - 1) / alignment * alignment;
+    bool wraps = start + max_size > m_capacity;
+
+    if (wraps) start = 0;
+
+    if (m_persistent_pointer != NULL)
+    {
+        // Every draw reading the segments we are leaving has been issued by
+        // now, so fence them before we come back around to them. That is each
+        // one written since the last fence, not just the one m_offset is in:
+        // a single reservation can run across several.
+        if (wraps)
+        {
+            fence_segments(m_unfenced_segment, SEGMENT_COUNT - 1);
+            m_unfenced_segment = 0;
+        }
+        else if (segment_of(start) > m_unfenced_segment)
+        {
+            fence_segments(m_unfenced_segment, segment_of(start) - 1);
+            m_unfenced_segment = segment_of(start);
+        }
+
+        wait_for_segments(segment_of(start), segment_of(start + max_size - 1));
+
+        m_reserved_offset = start;
+        return m_persistent_pointer + start;
+    }
+
+    gl_bind_buffer(m_target, m_buffer_id);
+
+    // Orphan on wrap: the driver hands us fresh storage while the GPU keeps
+    // reading the old one, and within a lap we never touch bytes twice.
+    if (wraps) glBufferData(m_target, m_capacity, NULL, GL_STREAM_DRAW);
+
+    void* pointer = glMapBufferRange(m_target, start, max_size,
+        GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT | GL_MAP_UNSYNCHRONIZED_BIT | GL_MAP_FLUSH_EXPLICIT_BIT);
+    m_is_mapped = true;
+
+    m_reserved_offset = start;
+    return pointer;
+}
+
+size_t StreamBuffer::commit(size_t used_size)
+{
+    if (m_is_mapped)
+    {
+        gl_bind_buffer(m_target, m_buffer_id);
+        if (used_size > 0) glFlushMappedBufferRange(m_target, 0, used_size);
+        glUnmapBuffer(m_target);
+        m_is_mapped = false;
+    }
+
+    m_offset = m_reserved_offset + used_size;
+    return m_reserved_offset;
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#ifdef _WINDOWS
+    #include <GL/glew.h>
+#endif
+#define GL_GLEXT_PROTOTYPES 1
+#include <SDL_opengl.h>
+#include <cstddef>
+
+// Creates a buffer whose contents never change after upload.
+GLuint create_static_buffer(GLenum target, size_t size, const void* data);
+
+// Index buffer for quads drawn as 4 vertices each (0 1 2, 0 2 3).
+GLuint create_quad_index_buffer(int max_quads);
+
+// Ring buffer for data that is rewritten every frame. Writers reserve space,
+// fill it in place and commit what they used; nothing is ever copied out of
+// client memory. Where ARB_buffer_storage is available the whole ring stays
+// persistently mapped and fences keep us from overwriting data the GPU has
+// not read yet; elsewhere each reservation is an unsynchronised map, and the
+// buffer is orphaned when it wraps.
+class StreamBuffer
+{
+private:
+    static const int SEGMENT_COUNT = 4;
+
+    GLenum m_target = GL_ARRAY_BUFFER;
+    GLuint m_buffer_id = 0;
+    size_t m_capacity = 0;
+    size_t m_offset = 0;
+
+    unsigned char* m_persistent_pointer = NULL;
+    GLsync m_segment_fences[SEGMENT_COUNT] = {};
+    int m_unfenced_segment = 0; // first segment written to since it was last fenced
+    bool m_is_mapped = false;
+
+    int  const segment_of(size_t offset) const { return (int)(offset * SEGMENT_COUNT / m_capacity); };
+    size_t m_reserved_offset = 0;
+
+    void wait_for_segments(int first, int last);
+    void fence_segments(int first, int last);
+
+public:
+    void initialise(GLenum target, size_t capacity);
+    void cleanup();
+
+    // Returns a write pointer to at least max_size bytes. The start of the
+    // region is aligned to `alignment` bytes (use the vertex stride so the
+    // region can be addressed with a base vertex).
+    void*  reserve(size_t max_size, size_t alignment);
+    // Publishes the first used_size bytes of the last reservation and returns
+    // their offset in the buffer.
+    size_t commit(size_t used_size);
+
+    GLuint const get_buffer_id()  const { return m_buffer_id;                     };
+    size_t const get_capacity()   const { return m_capacity;                      };
+    bool   const is_persistent()  const { return m_persistent_pointer != NULL;    };
+};
@@ -0,0 +1,101 @@
+#include <cstring>
+#include <iostream>
+#include "HeadlessContext.h"
+
+#ifndef _WINDOWS
+    #include <EGL/egl.h>
+    #include <EGL/eglext.h>
+#endif
+
+bool HeadlessContext::initialise()
+{
+#ifdef _WINDOWS
+    std::cout << "Headless rendering needs EGL, which this build does not have" << std::endl;
+    return false;
+#else
+    // STEP 1: Prefer a display that needs no window system at all
+    EGLDisplay display = EGL_NO_DISPLAY;
+    const char* client_extensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+
+    if (client_extensions != NULL && strstr(client_extensions, "EGL_MESA_platform_surfaceless") != NULL)
+    {
+        PFNEGLGETPLATFORMDISPLAYEXTPROC get_platform_display =
+            (PFNEGLGETPLATFORMDISPLAYEXTPROC)eglGetProcAddress("eglGetPlatformDisplayEXT");
+
+        if (get_platform_display != NULL)
+        {
+            display = get_platform_display(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, NULL);
+        }
+    }
+
+    if (display == EGL_NO_DISPLAY) display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+
+    if (display == EGL_NO_DISPLAY || !eglInitialize(display, NULL, NULL))
+    {
+        std::cout << "Headless: no EGL display available" << std::endl;
+        return false;
+    }
+    m_display = display;
+
+    // STEP 2: Desktop GL, like the windowed build, so every shader path is the same
+    const EGLint config_attributes[] = {
+        EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+        EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+        EGL_RED_SIZE, 8, EGL_GREEN_SIZE, 8, EGL_BLUE_SIZE, 8, EGL_ALPHA_SIZE, 8,
+        EGL_NONE
+    };
+
+    EGLConfig config;
+    EGLint config_count = 0;
+    if (!eglChooseConfig(display, config_attributes, &config, 1, &config_count) || config_count == 0 ||
+        !eglBindAPI(EGL_OPENGL_API))
+    {
+        std::cout << "Headless: no EGL config for desktop OpenGL" << std::endl;
+        cleanup();
+        return false;
+    }
+
+    EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, NULL);
+    if (context == EGL_NO_CONTEXT)
+    {
+        std::cout << "Headless: unable to create an EGL context" << std::endl;
+        cleanup();
+        return false;
+    }
+    m_context = context;
+
+    // STEP 3: We never draw to the surface, but some displays insist on one
+    const char* display_extensions = eglQueryString(display, EGL_EXTENSIONS);
+    EGLSurface surface = EGL_NO_SURFACE;
+
+    if (display_extensions == NULL || strstr(display_extensions, "EGL_KHR_surfaceless_context") == NULL)
+    {
+        const EGLint pbuffer_attributes[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+        surface = eglCreatePbufferSurface(display, config, pbuffer_attributes);
+        m_surface = surface;
+    }
+
+    if (!eglMakeCurrent(display, surface, surface, context))
+    {
+        std::cout << "Headless: unable to make the EGL context current" << std::endl;
+        cleanup();
+        return false;
+    }
+
+    return true;
+#endif
+}
+
+void HeadlessContext::cleanup()
+{
+#ifndef _WINDOWS
+    if (m_display == 0) return;
+
+    eglMakeCurrent(m_display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+    if (m_surface != 0) eglDestroySurface(m_display, m_surface);
+    if (m_context != 0) eglDestroyContext(m_display, m_context);
+    eglTerminate(m_display);
+#endif
+
+    m_display = m_context = m_surface = 0;
+}
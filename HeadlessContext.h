@@ -0,0 +1,23 @@
+#pragma once
+
+// An OpenGL context with no window and no display server behind it, for CI
+// machines that only have Mesa's llvmpipe. It has no default framebuffer, so
+// everything is drawn into a FrameCapture target.
+//
+// Built on EGL: the Mesa surfaceless platform where it exists, otherwise the
+// default display with a tiny pbuffer. EGL is not part of our Windows
+// toolchain, so there initialise() just reports that headless mode is
+// unavailable.
+class HeadlessContext
+{
+private:
+    void* m_display = 0; // EGLDisplay, EGLContext and EGLSurface are all pointers
+    void* m_context = 0;
+    void* m_surface = 0;
+
+public:
+    bool initialise();
+    void cleanup();
+
+    bool const is_ready() const { return m_context != 0; };
+};
@@ -0,0 +1,143 @@
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include "ImageResize.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define RESIZE_SSE2 1
+#endif
+
+// The source pixels one destination pixel covers, and how much of each
+struct Footprint
+{
+    int first;
+    std::vector<float> weights; // sum to 1
+};
+
+static void compute_footprints(int size, int new_size, std::vector<Footprint> &footprints)
+{
+    double scale = (double)size / new_size;
+    footprints.resize(new_size);
+
+    for (int i = 0; i < new_size; i++)
+    {
+        double start = i * scale, end = (i + 1) * scale;
+        int first = (int)start;
+        int last = std::min((int)ceil(end), size);
+
+        footprints[i].first = first;
+        footprints[i].weights.clear();
+        for (int j = first; j < last; j++)
+        {
+            double covered = std::min(end, j + 1.0) - std::max(start, (double)j);
+            footprints[i].weights.push_back((float)(covered / scale));
+        }
+    }
+}
+
+// ––––– ONE PIXEL OF FOUR FLOATS ––––– //
+#ifdef RESIZE_SSE2
+typedef __m128 Pixel;
+
+static inline Pixel pixel_zero() { return _mm_setzero_ps(); }
+static inline Pixel pixel_load(const float* p) { return _mm_loadu_ps(p); }
+static inline void pixel_store(float* p, Pixel value) { _mm_storeu_ps(p, value); }
+static inline Pixel pixel_add_weighted(Pixel sum, Pixel value, float weight)
+{
+    return _mm_add_ps(sum, _mm_mul_ps(value, _mm_set1_ps(weight)));
+}
+
+// (r a, g a, b a, a) from 8-bit straight alpha
+static inline Pixel pixel_premultiply(const unsigned char* texel)
+{
+    __m128i zero = _mm_setzero_si128();
+    __m128i widened = _mm_unpacklo_epi16(_mm_unpacklo_epi8(_mm_cvtsi32_si128(*(const int*)texel), zero), zero);
+    __m128 value = _mm_cvtepi32_ps(widened);
+    __m128 alpha = _mm_shuffle_ps(value, value, _MM_SHUFFLE(3, 3, 3, 3));
+
+    // Multiply colour by alpha and leave alpha itself alone
+    __m128 factor = _mm_or_ps(_mm_and_ps(alpha, _mm_castsi128_ps(_mm_setr_epi32(-1, -1, -1, 0))),
+                              _mm_setr_ps(0.0f, 0.0f, 0.0f, 1.0f));
+    return _mm_mul_ps(value, factor);
+}
+#else
+struct Pixel { float c[4]; };
+
+static inline Pixel pixel_zero() { Pixel p = { { 0.0f, 0.0f, 0.0f, 0.0f } }; return p; }
+static inline Pixel pixel_load(const float* p) { Pixel value = { { p[0], p[1], p[2], p[3] } }; return value; }
+static inline void pixel_store(float* p, Pixel value) { for (int i = 0; i < 4; i++) p[i] = value.c[i]; }
+static inline Pixel pixel_add_weighted(Pixel sum, Pixel value, float weight)
+{
+    for (int i = 0; i < 4; i++) sum.c[i] += value.c[i] * weight;
+    return sum;
+}
+
+static inline Pixel pixel_premultiply(const unsigned char* texel)
+{
+    Pixel value = { { (float)texel[0] * texel[3], (float)texel[1] * texel[3], (float)texel[2] * texel[3], (float)texel[3] } };
+    return value;
+}
+#endif
+
+void resize_rgba(const unsigned char* source, int width, int height,
+                 unsigned char* destination, int new_width, int new_height)
+{
+    std::vector<Footprint> columns, rows;
+    compute_footprints(width, new_width, columns);
+    compute_footprints(height, new_height, rows);
+
+    // STEP 1: Rows first, into premultiplied floats at the new width
+    std::vector<float> narrowed((size_t)new_width * height * 4);
+
+    for (int y = 0; y < height; y++)
+    {
+        const unsigned char* source_row = &source[(size_t)y * width * 4];
+
+        for (int x = 0; x < new_width; x++)
+        {
+            const Footprint &footprint = columns[x];
+            Pixel sum = pixel_zero();
+
+            for (int k = 0; k < (int)footprint.weights.size(); k++)
+            {
+                sum = pixel_add_weighted(sum, pixel_premultiply(&source_row[(footprint.first + k) * 4]), footprint.weights[k]);
+            }
+
+            pixel_store(&narrowed[((size_t)y * new_width + x) * 4], sum);
+        }
+    }
+
+    // STEP 2: Then columns, straight back to 8-bit straight alpha
+    std::vector<float> row((size_t)new_width * 4);
+
+    for (int y = 0; y < new_height; y++)
+    {
+        const Footprint &footprint = rows[y];
+
+        for (int x = 0; x < new_width; x++)
+        {
+            Pixel sum = pixel_zero();
+            for (int k = 0; k < (int)footprint.weights.size(); k++)
+            {
+                sum = pixel_add_weighted(sum, pixel_load(&narrowed[((size_t)(footprint.first + k) * new_width + x) * 4]),
+                    footprint.weights[k]);
+            }
+            pixel_store(&row[x * 4], sum);
+        }
+
+        for (int x = 0; x < new_width; x++)
+        {
+            const float* pixel = &row[x * 4];
+            unsigned char* out = &destination[((size_t)y * new_width + x) * 4];
+            float alpha = pixel[3];
+
+            for (int c = 0; c < 3; c++)
+            {
+                float colour = alpha > 0.0f ? pixel[c] / alpha : 0.0f;
+                out[c] = (unsigned char)std::min(std::max(colour + 0.5f, 0.0f), 255.0f);
+            }
+            out[3] = (unsigned char)std::min(std::max(alpha + 0.5f, 0.0f), 255.0f);
+        }
+    }
+}
@@ -0,0 +1,12 @@
+#pragma once
+
+// Shrinks an RGBA image to any smaller size with an area-averaging box
+// filter: every destination pixel is the exact coverage-weighted mean of the
+// source pixels under it, so nothing is skipped however large the ratio.
+// Colour is weighted by alpha, so fully transparent pixels (whatever colour
+// they happen to store) never bleed into the edges of what they surround.
+//
+// Both passes work on four float channels at once, one SSE register per
+// pixel where the compiler has SSE, plain floats otherwise.
+void resize_rgba(const unsigned char* source, int width, int height,
+                 unsigned char* destination, int new_width, int new_height);
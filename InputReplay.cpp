@@ -0,0 +1,88 @@
+#include <fstream>
+#include <iostream>
+#include <string>
+#include "InputReplay.h"
+
+const char KEY_LETTERS[] = { 'l', 'r', 'u' };
+const int KEY_COUNT = sizeof(KEY_LETTERS);
+
+bool InputReplay::load(const char* filepath)
+{
+    std::ifstream file(filepath);
+    if (!file)
+    {
+        std::cout << "Replay: unable to open " << filepath << std::endl;
+        return false;
+    }
+
+    m_changes.clear();
+
+    int frame;
+    std::string letters;
+    while (file >> frame >> letters)
+    {
+        int keys = 0;
+        for (int i = 0; i < (int)letters.size(); i++)
+        {
+            for (int key = 0; key < KEY_COUNT; key++)
+            {
+                if (letters[i] == KEY_LETTERS[key]) keys |= 1 << key;
+            }
+        }
+
+        record(frame, keys);
+    }
+
+    std::cout << "Replay: " << m_changes.size() << " key changes, the last on frame " << get_last_frame()
+              << ", from " << filepath << std::endl;
+    return true;
+}
+
+bool InputReplay::save(const char* filepath) const
+{
+    std::ofstream file(filepath);
+    if (!file)
+    {
+        std::cout << "Replay: unable to write " << filepath << std::endl;
+        return false;
+    }
+
+    for (int i = 0; i < (int)m_changes.size(); i++)
+    {
+        std::string letters;
+        for (int key = 0; key < KEY_COUNT; key++)
+        {
+            if (m_changes[i].keys & (1 << key)) letters += KEY_LETTERS[key];
+        }
+
+        file << m_changes[i].frame << " " << (letters.empty() ? "-" : letters) << "\n";
+    }
+
+    return true;
+}
+
+void InputReplay::record(int frame, int keys)
+{
+    // Frames before the first change have no keys held
+    int previous_keys = m_changes.empty() ? 0 : m_changes.back().keys;
+    if (keys == previous_keys) return;
+
+    KeyChange change;
+    change.frame = frame;
+    change.keys = keys;
+    m_changes.push_back(change);
+}
+
+int const InputReplay::get_keys(int frame) const
+{
+    // The last change at or before the frame
+    int low = 0, high = (int)m_changes.size();
+    while (low < high)
+    {
+        int middle = (low + high) / 2;
+        if (m_changes[middle].frame <= frame) low = middle + 1;
+        else                                  high = middle;
+    }
+
+    return low == 0 ? 0 : m_changes[low - 1].keys;
+}
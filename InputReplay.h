@@ -0,0 +1,35 @@
+#pragma once
+
+#include <vector>
+
+enum InputKey { INPUT_LEFT = 1, INPUT_RIGHT = 2, INPUT_UP = 4 };
+
+// The keys held on every frame of a run, so it can be played again, for
+// instance by a headless render. Only changes are kept. On disk it is a text
+// file with one "<frame> <keys>" line per change, where keys are some of
+// "lru", or "-" for none.
+//
+// Frames are calls to process_input, and input still acts per frame, so a
+// replay only reproduces its run exactly at the frame rate it was recorded at.
+class InputReplay
+{
+private:
+    struct KeyChange
+    {
+        int frame;
+        int keys;
+    };
+
+    std::vector<KeyChange> m_changes; // in frame order
+
+public:
+    bool load(const char* filepath);
+    bool save(const char* filepath) const;
+
+    void record(int frame, int keys);
+    int const get_keys(int frame) const;
+
+    // Frame of the last change; nothing happens after it
+    int  const get_last_frame() const { return m_changes.empty() ? 0 : m_changes.back().frame; };
+    bool const is_empty()       const { return m_changes.empty(); };
+};
@@ -0,0 +1,73 @@
+#include "JobPool.h"
+
+void JobPool::initialise(int worker_count)
+{
+    m_stopping = false;
+    for (int i = 0; i < worker_count; i++) m_workers.push_back(std::thread(&JobPool::worker_main, this));
+}
+
+void JobPool::cleanup()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_work_ready.notify_all();
+
+    for (int i = 0; i < (int)m_workers.size(); i++) m_workers[i].join();
+    m_workers.clear();
+}
+
+void JobPool::run(int job_count, const std::function<void(int)> &job)
+{
+    if (job_count <= 0) return;
+
+    if (job_count == 1 || m_workers.empty())
+    {
+        for (int i = 0; i < job_count; i++) job(i);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_job = &job;
+        m_job_count = job_count;
+        m_next_job = 0;
+        m_workers_busy = (int)m_workers.size();
+        m_generation++;
+    }
+    m_work_ready.notify_all();
+
+    take_jobs();
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_work_done.wait(lock, [this]() { return m_workers_busy == 0; });
+    m_job = NULL;
+}
+
+// ––––– WORKERS ––––– //
+
+void JobPool::worker_main()
+{
+    int generation = 0;
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_work_ready.wait(lock, [this, generation]() { return m_stopping || m_generation != generation; });
+            if (m_stopping) return;
+            generation = m_generation;
+        }
+
+        take_jobs();
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (--m_workers_busy == 0) m_work_done.notify_one();
+    }
+}
+
+void JobPool::take_jobs()
+{
+    for (int job = m_next_job++; job < m_job_count; job = m_next_job++) (*m_job)(job);
+}
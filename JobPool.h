@@ -0,0 +1,44 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// A few threads kept waiting for work, so a frame can split a loop across
+// cores without starting any. run() hands out job indices until they are all
+// taken and returns once every job has finished; the calling thread takes
+// jobs too, so a single job never wakes anyone.
+//
+// Jobs must not touch GL: whatever they produce is submitted afterwards by
+// the thread that called run().
+class JobPool
+{
+private:
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_work_ready, m_work_done;
+    int m_generation = 0;   // bumped once per run to wake the workers
+    int m_workers_busy = 0;
+    bool m_stopping = false;
+
+    const std::function<void(int)>* m_job = NULL;
+    int m_job_count = 0;
+    std::atomic<int> m_next_job;
+
+    void worker_main();
+    void take_jobs();
+
+public:
+    JobPool() : m_next_job(0) {}
+
+    // Threads beyond the caller's own; 0 runs everything on the caller
+    void initialise(int worker_count);
+    void cleanup();
+
+    void run(int job_count, const std::function<void(int)> &job);
+
+    int const get_thread_count() const { return (int)m_workers.size() + 1; };
+};
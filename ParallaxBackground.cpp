@@ -0,0 +1,301 @@
+#define GL_SILENCE_DEPRECATION
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include "glm/mat4x4.hpp"
+#include "glm/vec4.hpp"
+#include "stb_image.h"
+#include "GLExtensions.h"
+#include "GLState.h"
+#include "ParallaxBackground.h"
+#include "RenderSnapshot.h"
+#include "SoftwareRasteriser.h"
+
+static int floor_divide(float value, float size)
+{
+    return (int)std::floor(value / size);
+}
+
+void ParallaxBackground::initialise(const glm::vec2 &view_half_size)
+{
+    m_view_half_size = view_half_size;
+    m_build = 0;
+    m_tiles_uploaded = 0;
+    m_slot_pixels.resize((size_t)SLOT_TEXELS * SLOT_TEXELS * 4);
+}
+
+void ParallaxBackground::cleanup()
+{
+    for (int i = 0; i < (int)m_layers.size(); i++) gl_delete_texture(m_layers[i].texture_id);
+
+    m_layers.clear();
+    m_sources.clear();
+    std::vector<unsigned char>().swap(m_slot_pixels);
+}
+
+bool ParallaxBackground::add_layer(const ParallaxLayer &description)
+{
+    if ((int)m_layers.size() >= MAX_BACKGROUND_LAYERS)
+    {
+        std::cout << "Only " << MAX_BACKGROUND_LAYERS << " background layers fit between the render layers" << std::endl;
+        return false;
+    }
+
+    // STEP 1: Decode the image, unless an earlier layer already has
+    std::map<std::string, SourceImage>::iterator found = m_sources.find(description.filepath);
+    if (found == m_sources.end())
+    {
+        int width, height, number_of_components;
+        unsigned char* image = stbi_load(description.filepath.c_str(), &width, &height, &number_of_components,
+            STBI_rgb_alpha);
+
+        if (image == NULL)
+        {
+            std::cout << "Unable to load image " << description.filepath << ". Make sure the path is correct."
+                << std::endl;
+            return false;
+        }
+
+        SourceImage &source = m_sources[description.filepath];
+        source.width = width;
+        source.height = height;
+        source.pixels.assign(image, image + (size_t)width * height * 4);
+        stbi_image_free(image);
+
+        found = m_sources.find(description.filepath);
+    }
+
+    Layer layer;
+    layer.description = description;
+    layer.source = &found->second;
+    layer.band_bottom = description.band_bottom < 0 ? layer.source->height
+                                                    : std::min(description.band_bottom, layer.source->height);
+    layer.columns = (layer.source->width + TILE_TEXELS - 1) / TILE_TEXELS;
+    layer.rows = (layer.band_bottom - description.band_top + TILE_TEXELS - 1) / TILE_TEXELS;
+    layer.texel_size = description.image_size / glm::vec2(layer.source->width, layer.source->height);
+
+    // STEP 2: Room for every tile one view (plus a step's movement) can
+    // touch. The seam between repeats puts two narrow tiles side by side,
+    // hence one more column than rows.
+    glm::vec2 tile_size = layer.texel_size * (float)TILE_TEXELS;
+    int columns_needed = std::min(layer.columns, (int)std::ceil(2.0f * m_view_half_size.x / tile_size.x) + 3);
+    int rows_needed = std::min(layer.rows, (int)std::ceil(2.0f * m_view_half_size.y / tile_size.y) + 2);
+
+    layer.slot_count = columns_needed * rows_needed;
+    layer.slots_across = (int)std::ceil(std::sqrt((float)layer.slot_count));
+    layer.page_width = layer.slots_across * SLOT_TEXELS;
+    layer.page_height = ((layer.slot_count + layer.slots_across - 1) / layer.slots_across) * SLOT_TEXELS;
+
+    layer.slot_tiles.assign(layer.slot_count, -1);
+    layer.slot_stamps.assign(layer.slot_count, 0);
+    layer.tile_slots.assign(layer.columns * layer.rows, -1);
+    layer.uploaded_tiles.assign(layer.slot_count, -1);
+
+    // STEP 3: An empty page; tiles arrive as they are needed. Like the atlas,
+    // it is magnified with nearest filtering. Without a context only the
+    // software rasteriser's copy of it exists.
+    layer.texture_id = gl_gen_texture();
+    if (gl_has_context())
+    {
+        gl_bind_texture(layer.texture_id);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, layer.page_width, layer.page_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+
+    std::cout << "Background layer " << m_layers.size() << ": " << layer.columns << "x" << layer.rows << " tiles, "
+        << layer.slot_count << " slots in a " << layer.page_width << "x" << layer.page_height << " page" << std::endl;
+
+    m_layers.push_back(layer);
+    return true;
+}
+
+int ParallaxBackground::find_slot(Layer &layer, int tile)
+{
+    int slot = layer.tile_slots[tile];
+
+    if (slot < 0)
+    {
+        // The least recently used slot that this build has not claimed yet
+        for (int i = 0; i < layer.slot_count; i++)
+        {
+            if (layer.slot_stamps[i] == m_build) continue;
+            if (slot < 0 || layer.slot_stamps[i] < layer.slot_stamps[slot]) slot = i;
+        }
+        if (slot < 0) return -1;
+
+        if (layer.slot_tiles[slot] >= 0) layer.tile_slots[layer.slot_tiles[slot]] = -1;
+        layer.slot_tiles[slot] = tile;
+        layer.tile_slots[tile] = slot;
+    }
+
+    layer.slot_stamps[slot] = m_build;
+    return slot;
+}
+
+void ParallaxBackground::build(RenderSnapshot* snapshot)
+{
+    m_build++;
+    snapshot->background.slot_tiles.clear();
+
+    for (int l = 0; l < (int)m_layers.size(); l++)
+    {
+        Layer &layer = m_layers[l];
+        const ParallaxLayer &description = layer.description;
+        int width = layer.source->width;
+        snapshot->layer = LAYER_BACKGROUND + l;
+
+        // STEP 1: Work in the layer's own space, where it stands still and
+        // the view moves `scroll` times as far as the camera does
+        glm::vec2 layer_offset = snapshot->camera * (1.0f - description.scroll);
+        glm::vec2 previous_layer_offset = snapshot->previous_camera * (1.0f - description.scroll);
+        glm::vec2 view_min = glm::min(snapshot->camera, snapshot->previous_camera) * description.scroll - m_view_half_size;
+        glm::vec2 view_max = glm::max(snapshot->camera, snapshot->previous_camera) * description.scroll + m_view_half_size;
+
+        float image_left = description.image_centre.x - description.image_size.x / 2.0f;
+        float band_top = description.image_centre.y + description.image_size.y / 2.0f
+            - description.band_top * layer.texel_size.y;
+
+        // STEP 2: Every tile of every repeat in view gets a slot and a sprite
+        int first_repeat = floor_divide(view_min.x - image_left, description.image_size.x);
+        int last_repeat = floor_divide(view_max.x - image_left, description.image_size.x);
+
+        for (int row = 0; row < layer.rows; row++)
+        {
+            int row_top = description.band_top + row * TILE_TEXELS;
+            int row_height = std::min(TILE_TEXELS, layer.band_bottom - row_top);
+            float top = band_top - (row * TILE_TEXELS) * layer.texel_size.y;
+            float bottom = top - row_height * layer.texel_size.y;
+            if (top < view_min.y || bottom > view_max.y) continue;
+
+            for (int repeat = first_repeat; repeat <= last_repeat; repeat++)
+            {
+                bool mirrored = (repeat & 1) != 0;
+                float repeat_left = image_left + repeat * description.image_size.x;
+
+                for (int column = 0; column < layer.columns; column++)
+                {
+                    int column_left = column * TILE_TEXELS;
+                    int column_width = std::min(TILE_TEXELS, width - column_left);
+                    int placed_left = mirrored ? width - column_left - column_width : column_left;
+
+                    float left = repeat_left + placed_left * layer.texel_size.x;
+                    float right = left + column_width * layer.texel_size.x;
+                    if (right < view_min.x || left > view_max.x) continue;
+
+                    int slot = find_slot(layer, row * layer.columns + column);
+                    if (slot < 0) continue;
+
+                    // The tile sits one texel into its slot, past the gutter
+                    float slot_x = (float)((slot % layer.slots_across) * SLOT_TEXELS + 1);
+                    float slot_y = (float)((slot / layer.slots_across) * SLOT_TEXELS + 1);
+                    glm::vec4 uv_rect = glm::vec4(slot_x / layer.page_width, slot_y / layer.page_height,
+                        (slot_x + column_width) / layer.page_width, (slot_y + row_height) / layer.page_height);
+                    if (mirrored) std::swap(uv_rect.x, uv_rect.z);
+
+                    glm::mat4 model_matrix = glm::mat4(1.0f);
+                    model_matrix[0][0] = right - left;
+                    model_matrix[1][1] = top - bottom;
+                    model_matrix[3][0] = (left + right) / 2.0f + layer_offset.x;
+                    model_matrix[3][1] = (top + bottom) / 2.0f + layer_offset.y;
+
+                    glm::mat4 previous_model_matrix = model_matrix;
+                    previous_model_matrix[3][0] += previous_layer_offset.x - layer_offset.x;
+                    previous_model_matrix[3][1] += previous_layer_offset.y - layer_offset.y;
+
+                    snapshot->add_sprite(layer.texture_id, previous_model_matrix, model_matrix, uv_rect,
+                        glm::vec4(1.0f));
+                }
+            }
+        }
+
+        snapshot->background.slot_tiles.insert(snapshot->background.slot_tiles.end(),
+            layer.slot_tiles.begin(), layer.slot_tiles.end());
+    }
+}
+
+void ParallaxBackground::cut_tile(const Layer &layer, int tile)
+{
+    const SourceImage &source = *layer.source;
+    const ParallaxLayer &description = layer.description;
+    int left = (tile % layer.columns) * TILE_TEXELS - 1;
+    int top = description.band_top + (tile / layer.columns) * TILE_TEXELS - 1;
+
+    // Texels past the tile (the gutter, and the rest of a narrow tile's slot)
+    // repeat whatever is nearest in the band
+    for (int y = 0; y < SLOT_TEXELS; y++)
+    {
+        int source_y = std::min(std::max(top + y, description.band_top), layer.band_bottom - 1);
+        int fade = source_y - description.band_top;
+        const unsigned char* row = &source.pixels[(size_t)source_y * source.width * 4];
+        unsigned char* destination = &m_slot_pixels[(size_t)y * SLOT_TEXELS * 4];
+
+        for (int x = 0; x < SLOT_TEXELS; x++)
+        {
+            int source_x = std::min(std::max(left + x, 0), source.width - 1);
+            memcpy(&destination[x * 4], &row[source_x * 4], 4);
+
+            if (fade < description.fade_rows)
+            {
+                destination[x * 4 + 3] = (unsigned char)(destination[x * 4 + 3] * (fade + 0.5f) / description.fade_rows);
+            }
+        }
+    }
+}
+
+void ParallaxBackground::upload(const BackgroundFrame &frame, SoftwareRasteriser* rasteriser)
+{
+    int first_slot = 0;
+
+    for (int l = 0; l < (int)m_layers.size(); l++)
+    {
+        Layer &layer = m_layers[l];
+
+        // The rasteriser learns of each page the first time it is needed
+        if (rasteriser != NULL && !layer.in_rasteriser)
+        {
+            std::vector<unsigned char> blank((size_t)layer.page_width * layer.page_height * 4, 0);
+            rasteriser->add_texture(layer.texture_id, layer.page_width, layer.page_height, blank.data());
+            rasteriser->set_filters(layer.texture_id, GL_LINEAR, GL_NEAREST); // as add_layer sets up the GL page
+            layer.in_rasteriser = true;
+        }
+
+        for (int slot = 0; slot < layer.slot_count && first_slot + slot < (int)frame.slot_tiles.size(); slot++)
+        {
+            int tile = frame.slot_tiles[first_slot + slot];
+            if (tile < 0 || tile == layer.uploaded_tiles[slot]) continue;
+
+            cut_tile(layer, tile);
+
+            int x = (slot % layer.slots_across) * SLOT_TEXELS;
+            int y = (slot / layer.slots_across) * SLOT_TEXELS;
+            if (rasteriser != NULL)
+            {
+                rasteriser->update_texture(layer.texture_id, x, y, SLOT_TEXELS, SLOT_TEXELS, m_slot_pixels.data());
+            }
+            else
+            {
+                gl_bind_texture(layer.texture_id);
+                glTexSubImage2D(GL_TEXTURE_2D, 0, x, y, SLOT_TEXELS, SLOT_TEXELS, GL_RGBA, GL_UNSIGNED_BYTE,
+                    m_slot_pixels.data());
+            }
+
+            layer.uploaded_tiles[slot] = tile;
+            m_tiles_uploaded++;
+        }
+
+        first_slot += layer.slot_count;
+    }
+}
+
+int const ParallaxBackground::get_page_bytes() const
+{
+    int bytes = 0;
+    for (int i = 0; i < (int)m_layers.size(); i++) bytes += m_layers[i].page_width * m_layers[i].page_height * 4;
+
+    return bytes;
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#ifdef _WINDOWS
+    #include <GL/glew.h>
+#endif
+#define GL_GLEXT_PROTOTYPES 1
+#include <SDL_opengl.h>
+#include <map>
+#include <string>
+#include <vector>
+#include "glm/vec2.hpp"
+
+struct RenderSnapshot;
+class SoftwareRasteriser;
+
+// One depth layer of the background: a horizontal band of an image, repeated
+// along x for as long as the level goes. Every other repeat is mirrored, so
+// the image's left and right edges always meet themselves.
+struct ParallaxLayer
+{
+    std::string filepath;
+    int band_top = 0, band_bottom = -1;          // source rows the layer shows; -1 for the last row
+    glm::vec2 image_centre = glm::vec2(0.0f);    // where the whole image sits with the camera at the origin
+    glm::vec2 image_size = glm::vec2(1.0f);      // world size of the whole image
+    float scroll = 1.0f;                         // 1 moves with the level, 0 stays with the camera
+    int fade_rows = 0;                           // rows at the top of the band that fade in, to hide its edge
+};
+
+// Which tile each page slot should hold, layer after layer, as of one
+// snapshot. -1 marks a slot that has never been used.
+struct BackgroundFrame
+{
+    std::vector<int> slot_tiles;
+};
+
+// Parallax background built from tiles that stream through a small page
+// texture per layer.
+//
+// The layers are cut into TILE_TEXELS squares. Each layer has one page
+// texture, with room for the tiles that can be on screen at once, and no
+// more. The simulation decides which tiles every snapshot needs. It keeps
+// the ones already in a slot and gives new ones the least recently used
+// slot. The renderer compares that assignment with what it last uploaded
+// and cuts out and uploads only the tiles that changed. Because it compares
+// whole assignments, snapshots the renderer skips lose nothing. Memory is
+// one page per layer plus the decoded source images, however long the
+// level is.
+//
+// All of a layer's tiles share its page, so the sprite batch draws each
+// layer in a single call.
+class ParallaxBackground
+{
+private:
+    static const int TILE_TEXELS = 128;
+    static const int SLOT_TEXELS = TILE_TEXELS + 2; // plus a one-texel gutter copied from the neighbours
+
+    struct SourceImage
+    {
+        int width = 0, height = 0;
+        std::vector<unsigned char> pixels; // RGBA, top row first
+    };
+
+    struct Layer
+    {
+        ParallaxLayer description;
+        const SourceImage* source = NULL;
+        int band_bottom = 0;
+        int columns = 0, rows = 0;       // tiles across the image and down the band
+        glm::vec2 texel_size;            // world size of one source pixel
+
+        GLuint texture_id = 0;
+        int slots_across = 0, slot_count = 0;
+        int page_width = 0, page_height = 0;
+
+        // ––––– SIMULATION SIDE ––––– //
+        std::vector<int> slot_tiles;          // tile in each slot, or -1
+        std::vector<int> tile_slots;          // slot of each tile, or -1
+        std::vector<unsigned int> slot_stamps; // build that last needed each slot
+
+        // ––––– RENDER SIDE ––––– //
+        std::vector<int> uploaded_tiles;      // what the page actually holds
+        bool in_rasteriser = false;
+    };
+
+    glm::vec2 m_view_half_size = glm::vec2(0.0f);
+    std::map<std::string, SourceImage> m_sources;
+    std::vector<Layer> m_layers;
+    unsigned int m_build = 0;
+
+    std::vector<unsigned char> m_slot_pixels; // one slot, cut out for upload
+    int m_tiles_uploaded = 0;
+
+    int  find_slot(Layer &layer, int tile);
+    void cut_tile(const Layer &layer, int tile);
+
+public:
+    // Pages are sized for a view this big, in world units either side of the camera
+    void initialise(const glm::vec2 &view_half_size);
+    void cleanup();
+
+    // Decodes the image (once per file) and creates the layer's page. Layers
+    // draw in the order they are added.
+    bool add_layer(const ParallaxLayer &layer);
+
+    // Simulation thread: picks the tiles both of the snapshot's cameras see,
+    // streams them into slots and adds their sprites, each layer in its own
+    // render layer from LAYER_BACKGROUND up.
+    void build(RenderSnapshot* snapshot);
+
+    // Render thread: brings the pages up to date with a snapshot, either the
+    // GL textures or the software rasteriser's copies of them
+    void upload(const BackgroundFrame &frame, SoftwareRasteriser* rasteriser = NULL);
+
+    int const get_tiles_uploaded() const { return m_tiles_uploaded; };
+    int const get_page_bytes()     const;
+};
@@ -0,0 +1,92 @@
+#define GL_SILENCE_DEPRECATION
+
+#include <cstring>
+#include "GLState.h"
+#include "ParticleRenderer.h"
+
+// Corners of the unit quad in triangle-strip order
+static const float UNIT_QUAD[] = { -0.5f, -0.5f,  0.5f, -0.5f,  -0.5f, 0.5f,  0.5f, 0.5f };
+
+void ParticleRenderer::initialise(int capacity)
+{
+    m_capacity = capacity;
+    m_instance_buffer.initialise(GL_ARRAY_BUFFER, (size_t)FRAMES_IN_FLIGHT * capacity * BYTES_PER_PARTICLE);
+    m_unit_quad_buffer = create_static_buffer(GL_ARRAY_BUFFER, sizeof(UNIT_QUAD), UNIT_QUAD);
+}
+
+void ParticleRenderer::cleanup()
+{
+    if (m_vertex_array != 0) gl_delete_vertex_array(m_vertex_array);
+    m_instance_buffer.cleanup();
+    gl_delete_buffer(m_unit_quad_buffer);
+
+    m_vertex_array = 0;
+    m_vertex_array_program = 0;
+    m_unit_quad_buffer = 0;
+    m_capacity = 0;
+}
+
+void ParticleRenderer::create_vertex_array(ShaderProgram* program)
+{
+    if (m_vertex_array != 0) gl_delete_vertex_array(m_vertex_array);
+
+    glGenVertexArrays(1, &m_vertex_array);
+    gl_bind_vertex_array(m_vertex_array);
+    m_vertex_array_program = program->get_program_id();
+
+    // The unit quad advances per vertex...
+    gl_bind_buffer(GL_ARRAY_BUFFER, m_unit_quad_buffer);
+    glVertexAttribPointer(program->get_position_attribute(), 2, GL_FLOAT, false, 0, (void*)0);
+    gl_enable_vertex_attrib_array(program->get_position_attribute());
+
+    // ...everything else once per particle
+    for (int i = 0; i < PARTICLE_ATTRIBUTE_COUNT; i++)
+    {
+        gl_enable_vertex_attrib_array(program->get_particle_attribute(i));
+        glVertexAttribDivisor(program->get_particle_attribute(i), 1);
+    }
+
+    gl_enable_vertex_attrib_array(program->get_tint_attribute());
+    glVertexAttribDivisor(program->get_tint_attribute(), 1);
+}
+
+int ParticleRenderer::draw(ShaderProgram* program, const ParticleFrame &frame, float rewind)
+{
+    int count = frame.count < m_capacity ? frame.count : m_capacity;
+    if (count <= 0) return 0;
+
+    if (m_vertex_array_program != program->get_program_id()) create_vertex_array(program);
+
+    // STEP 1: Copy the arrays, one after another, into this frame's slice
+    const float* arrays[PARTICLE_ATTRIBUTE_COUNT] = {
+        frame.x.data(), frame.y.data(), frame.velocity_x.data(), frame.velocity_y.data(),
+        frame.size.data(), frame.alpha.data()
+    };
+    size_t array_size = (size_t)count * 4;
+
+    unsigned char* write_pointer = (unsigned char*)m_instance_buffer.reserve(count * BYTES_PER_PARTICLE, 4);
+    for (int i = 0; i < PARTICLE_ATTRIBUTE_COUNT; i++) memcpy(write_pointer + i * array_size, arrays[i], array_size);
+    memcpy(write_pointer + PARTICLE_ATTRIBUTE_COUNT * array_size, frame.colour.data(), array_size);
+
+    size_t offset = m_instance_buffer.commit(count * BYTES_PER_PARTICLE);
+
+    // STEP 2: Point each attribute at its array. Base instances need GL 4.2,
+    // so this is redone for every frame's slice; seven calls in all.
+    gl_bind_vertex_array(m_vertex_array);
+    gl_bind_buffer(GL_ARRAY_BUFFER, m_instance_buffer.get_buffer_id());
+
+    for (int i = 0; i < PARTICLE_ATTRIBUTE_COUNT; i++)
+    {
+        glVertexAttribPointer(program->get_particle_attribute(i), 1, GL_FLOAT, false, 0,
+            (void*)(offset + i * array_size));
+    }
+    glVertexAttribPointer(program->get_tint_attribute(), 4, GL_UNSIGNED_BYTE, true, 0,
+        (void*)(offset + PARTICLE_ATTRIBUTE_COUNT * array_size));
+
+    // STEP 3: Draw them all at once
+    program->set_rewind(rewind);
+    gl_use_program(program->get_program_id());
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, count);
+
+    return count;
+}
@@ -0,0 +1,39 @@
+#pragma once
+
+#ifdef _WINDOWS
+    #include <GL/glew.h>
+#endif
+#define GL_GLEXT_PROTOTYPES 1
+#include <SDL_opengl.h>
+#include "GpuBuffer.h"
+#include "ParticleSystem.h"
+#include "ShaderProgram.h"
+
+// Draws a ParticleFrame in one instanced call with the PARTICLE shader. Each
+// of the frame's arrays is copied as it is into its own slice of a ring
+// buffer, and every attribute reads its slice with a divisor of one, so a
+// particle is 28 bytes on the way to the GPU and is never expanded into a
+// sprite on the CPU.
+class ParticleRenderer
+{
+private:
+    // x, y, velocity x, velocity y, size, alpha (floats) and colour (RGBA8)
+    static const int BYTES_PER_PARTICLE = 7 * 4;
+    static const int FRAMES_IN_FLIGHT = 4;
+
+    int m_capacity = 0;
+    StreamBuffer m_instance_buffer;
+    GLuint m_unit_quad_buffer = 0;
+    GLuint m_vertex_array = 0;
+    GLuint m_vertex_array_program = 0; // the program m_vertex_array was laid out for
+
+    void create_vertex_array(ShaderProgram* program);
+
+public:
+    void initialise(int capacity);
+    void cleanup();
+
+    // Draws up to the capacity, each particle wound back `rewind` seconds
+    // along its velocity. Returns how many were drawn.
+    int draw(ShaderProgram* program, const ParticleFrame &frame, float rewind);
+};
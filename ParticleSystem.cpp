@@ -0,0 +1,226 @@
+#include <algorithm>
+#include <cstring>
+#include "ParticleSystem.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define PARTICLES_SSE2 1
+#endif
+
+static unsigned int pack_colour(const glm::vec4 &colour)
+{
+    unsigned int packed = 0;
+
+    for (int i = 0; i < 4; i++)
+    {
+        float channel = std::min(std::max(colour[i], 0.0f), 1.0f);
+        packed |= (unsigned int)(channel * 255.0f + 0.5f) << (8 * i);
+    }
+
+    return packed;
+}
+
+void ParticleSystem::initialise(int capacity)
+{
+    // Padded so the vector pass can always work in whole groups of four
+    m_capacity = capacity;
+    int padded = (capacity + 3) & ~3;
+
+    m_x.assign(padded, 0.0f);
+    m_y.assign(padded, 0.0f);
+    m_velocity_x.assign(padded, 0.0f);
+    m_velocity_y.assign(padded, 0.0f);
+    m_acceleration_y.assign(padded, 0.0f);
+    m_age.assign(padded, 0.0f);
+    m_inverse_lifetime.assign(padded, 1.0f);
+    m_size.assign(padded, 0.0f);
+    m_alpha.assign(padded, 0.0f);
+    m_colour.assign(padded, 0);
+
+    m_count = m_peak_count = 0;
+}
+
+void ParticleSystem::cleanup()
+{
+    std::vector<float>().swap(m_x);
+    std::vector<float>().swap(m_y);
+    std::vector<float>().swap(m_velocity_x);
+    std::vector<float>().swap(m_velocity_y);
+    std::vector<float>().swap(m_acceleration_y);
+    std::vector<float>().swap(m_age);
+    std::vector<float>().swap(m_inverse_lifetime);
+    std::vector<float>().swap(m_size);
+    std::vector<float>().swap(m_alpha);
+    std::vector<unsigned int>().swap(m_colour);
+    m_capacity = m_count = 0;
+}
+
+// xorshift32, mapped onto [centre - spread, centre + spread)
+float ParticleSystem::random_range(float centre, float spread)
+{
+    m_random_state ^= m_random_state << 13;
+    m_random_state ^= m_random_state >> 17;
+    m_random_state ^= m_random_state << 5;
+
+    float unit = (float)(m_random_state >> 8) * (1.0f / 16777216.0f);
+    return centre + spread * (unit * 2.0f - 1.0f);
+}
+
+int ParticleSystem::emit(const ParticleEmitter &emitter, int count)
+{
+    count = std::min(count, m_capacity - m_count);
+    unsigned int colour = pack_colour(emitter.colour);
+
+    for (int n = 0; n < count; n++)
+    {
+        int i = m_count++;
+
+        m_x[i] = random_range(emitter.position.x, emitter.position_spread.x);
+        m_y[i] = random_range(emitter.position.y, emitter.position_spread.y);
+        m_velocity_x[i] = random_range(emitter.velocity.x, emitter.velocity_spread.x);
+        m_velocity_y[i] = random_range(emitter.velocity.y, emitter.velocity_spread.y);
+        m_acceleration_y[i] = emitter.acceleration_y;
+        m_age[i] = 0.0f;
+        m_inverse_lifetime[i] = 1.0f / std::max(random_range(emitter.lifetime, emitter.lifetime_spread), 0.001f);
+        m_size[i] = std::max(random_range(emitter.size, emitter.size_spread), 0.0f);
+        m_alpha[i] = 1.0f;
+        m_colour[i] = colour;
+    }
+
+    m_peak_count = std::max(m_peak_count, m_count);
+    return count;
+}
+
+void ParticleSystem::update(float delta_time)
+{
+    if (m_count == 0) return;
+
+    integrate(delta_time);
+    remove_dead();
+    m_version++;
+}
+
+void ParticleSystem::integrate(float delta_time)
+{
+    // Drag is applied as a factor per step, so it can never reverse a particle
+    float damping = std::max(1.0f - m_drag * delta_time, 0.0f);
+    int count = (m_count + 3) & ~3;
+
+    float* x = m_x.data();
+    float* y = m_y.data();
+    float* velocity_x = m_velocity_x.data();
+    float* velocity_y = m_velocity_y.data();
+    const float* acceleration_y = m_acceleration_y.data();
+    float* age = m_age.data();
+    const float* inverse_lifetime = m_inverse_lifetime.data();
+    float* alpha = m_alpha.data();
+
+#ifdef PARTICLES_SSE2
+    __m128 dt = _mm_set1_ps(delta_time);
+    __m128 damp = _mm_set1_ps(damping);
+    __m128 one = _mm_set1_ps(1.0f);
+    __m128 zero = _mm_setzero_ps();
+
+    for (int i = 0; i < count; i += 4)
+    {
+        __m128 vx = _mm_mul_ps(_mm_loadu_ps(&velocity_x[i]), damp);
+        __m128 vy = _mm_add_ps(_mm_mul_ps(_mm_loadu_ps(&velocity_y[i]), damp),
+                               _mm_mul_ps(_mm_loadu_ps(&acceleration_y[i]), dt));
+        _mm_storeu_ps(&velocity_x[i], vx);
+        _mm_storeu_ps(&velocity_y[i], vy);
+
+        _mm_storeu_ps(&x[i], _mm_add_ps(_mm_loadu_ps(&x[i]), _mm_mul_ps(vx, dt)));
+        _mm_storeu_ps(&y[i], _mm_add_ps(_mm_loadu_ps(&y[i]), _mm_mul_ps(vy, dt)));
+
+        __m128 new_age = _mm_add_ps(_mm_loadu_ps(&age[i]), dt);
+        _mm_storeu_ps(&age[i], new_age);
+
+        // Fades out linearly over the particle's life
+        __m128 life = _mm_mul_ps(new_age, _mm_loadu_ps(&inverse_lifetime[i]));
+        _mm_storeu_ps(&alpha[i], _mm_max_ps(_mm_sub_ps(one, life), zero));
+    }
+#else
+    for (int i = 0; i < count; i++)
+    {
+        velocity_x[i] *= damping;
+        velocity_y[i] = velocity_y[i] * damping + acceleration_y[i] * delta_time;
+
+        x[i] += velocity_x[i] * delta_time;
+        y[i] += velocity_y[i] * delta_time;
+
+        age[i] += delta_time;
+        alpha[i] = std::max(1.0f - age[i] * inverse_lifetime[i], 0.0f);
+    }
+#endif
+}
+
+void ParticleSystem::move_particle(int from, int to)
+{
+    m_x[to] = m_x[from];
+    m_y[to] = m_y[from];
+    m_velocity_x[to] = m_velocity_x[from];
+    m_velocity_y[to] = m_velocity_y[from];
+    m_acceleration_y[to] = m_acceleration_y[from];
+    m_age[to] = m_age[from];
+    m_inverse_lifetime[to] = m_inverse_lifetime[from];
+    m_size[to] = m_size[from];
+    m_alpha[to] = m_alpha[from];
+    m_colour[to] = m_colour[from];
+}
+
+void ParticleSystem::remove_dead()
+{
+    // A particle is dead once its alpha has faded to nothing
+    const float* alpha = m_alpha.data();
+    int i = 0;
+
+    while (i < m_count)
+    {
+#ifdef PARTICLES_SSE2
+        // Skip whole groups of four with nothing to remove
+        if (i + 4 <= m_count && _mm_movemask_ps(_mm_cmple_ps(_mm_loadu_ps(&alpha[i]), _mm_setzero_ps())) == 0)
+        {
+            i += 4;
+            continue;
+        }
+#endif
+        if (alpha[i] <= 0.0f)
+        {
+            // The last particle takes this one's place, and is checked in turn
+            m_count--;
+            if (i != m_count) move_particle(m_count, i);
+        }
+        else
+        {
+            i++;
+        }
+    }
+}
+
+void ParticleSystem::write_frame(ParticleFrame* frame) const
+{
+    frame->count = m_count;
+    frame->version = m_version;
+
+    // Only ever grown, so a steady stream of particles stops allocating
+    if ((int)frame->x.size() < m_count)
+    {
+        frame->x.resize(m_count);
+        frame->y.resize(m_count);
+        frame->velocity_x.resize(m_count);
+        frame->velocity_y.resize(m_count);
+        frame->size.resize(m_count);
+        frame->alpha.resize(m_count);
+        frame->colour.resize(m_count);
+    }
+    if (m_count == 0) return;
+
+    size_t bytes = (size_t)m_count * sizeof(float);
+    memcpy(frame->x.data(), m_x.data(), bytes);
+    memcpy(frame->y.data(), m_y.data(), bytes);
+    memcpy(frame->velocity_x.data(), m_velocity_x.data(), bytes);
+    memcpy(frame->velocity_y.data(), m_velocity_y.data(), bytes);
+    memcpy(frame->size.data(), m_size.data(), bytes);
+    memcpy(frame->alpha.data(), m_alpha.data(), bytes);
+    memcpy(frame->colour.data(), m_colour.data(), (size_t)m_count * sizeof(unsigned int));
+}
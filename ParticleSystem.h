@@ -0,0 +1,86 @@
+#pragma once
+
+#include <vector>
+#include "glm/vec2.hpp"
+#include "glm/vec4.hpp"
+
+// How a burst of particles starts out. Every "spread" is the half-width of a
+// uniform random range around the value before it.
+struct ParticleEmitter
+{
+    glm::vec2 position = glm::vec2(0.0f);
+    glm::vec2 position_spread = glm::vec2(0.0f);
+    glm::vec2 velocity = glm::vec2(0.0f);
+    glm::vec2 velocity_spread = glm::vec2(0.0f);
+    float acceleration_y = 0.0f; // buoyancy or gravity
+    float lifetime = 1.0f, lifetime_spread = 0.0f;
+    float size = 0.1f, size_spread = 0.0f;
+    glm::vec4 colour = glm::vec4(1.0f);
+};
+
+// What the renderer needs of every live particle, copied out with the rest of
+// a snapshot. Laid out like the pool itself, one array per attribute.
+struct ParticleFrame
+{
+    std::vector<float> x, y, velocity_x, velocity_y, size, alpha;
+    std::vector<unsigned int> colour; // RGBA8, before fading by alpha
+    int count = 0;
+    unsigned int version = 0; // changes with every step that moved them
+};
+
+// A fixed-capacity pool of short-lived particles, for thruster bubbles and
+// wreckage. Nothing is allocated once the pool is initialised: a burst that
+// does not fit is cut short.
+//
+// Every attribute lives in its own array (SoA), so a step is one pass over
+// contiguous floats that integrates, ages and fades four particles per SSE
+// instruction where the compiler has SSE. Dead particles are then swapped
+// with the last live one, which keeps the live ones packed at the front
+// and costs nothing for the (usual) runs of four with no deaths in them.
+// Arrays are padded to a multiple of four, so the vector pass never needs
+// a scalar tail.
+//
+// Random numbers come from the pool's own generator, so a replay sees the
+// same particles every time.
+class ParticleSystem
+{
+private:
+    int m_capacity = 0;
+    int m_count = 0;
+    int m_peak_count = 0;
+    unsigned int m_version = 0;
+    unsigned int m_random_state = 0x9e3779b9u;
+    float m_drag = 0.0f; // share of velocity lost per second
+
+    // ––––– PER-PARTICLE STATE (SoA) ––––– //
+    std::vector<float> m_x, m_y;
+    std::vector<float> m_velocity_x, m_velocity_y;
+    std::vector<float> m_acceleration_y;
+    std::vector<float> m_age, m_inverse_lifetime; // a particle dies when age * inverse_lifetime reaches 1
+    std::vector<float> m_size;
+    std::vector<float> m_alpha;
+    std::vector<unsigned int> m_colour;
+
+    float random_range(float centre, float spread);
+    void  integrate(float delta_time);
+    void  remove_dead();
+    void  move_particle(int from, int to);
+
+public:
+    void initialise(int capacity);
+    void cleanup();
+
+    // Returns how many were actually emitted
+    int  emit(const ParticleEmitter &emitter, int count);
+    void update(float delta_time);
+    void clear() { m_count = 0; m_version++; };
+
+    void set_drag(float drag) { m_drag = drag; };
+
+    // Copies the live particles out; the frame's arrays only ever grow
+    void write_frame(ParticleFrame* frame) const;
+
+    int const get_count()      const { return m_count;      };
+    int const get_capacity()   const { return m_capacity;   };
+    int const get_peak_count() const { return m_peak_count; };
+};
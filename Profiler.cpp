@@ -0,0 +1,180 @@
+#define GL_SILENCE_DEPRECATION
+
+#include <fstream>
+#include <iostream>
+#include "GLExtensions.h"
+#include "Profiler.h"
+
+const char* profile_section_name(int section)
+{
+    static const char* const NAMES[PROFILE_SECTION_COUNT] = {
+        "input", "update", "snapshot", "render", "swap", "gpu scene", "gpu hud"
+    };
+
+    return section >= 0 && section < PROFILE_SECTION_COUNT ? NAMES[section] : "?";
+}
+
+void Profiler::initialise()
+{
+    for (int i = 0; i < HISTORY_FRAMES; i++)
+    {
+        for (int section = 0; section < PROFILE_SECTION_COUNT; section++) m_history[i][section] = -1.0f;
+    }
+
+    for (int slot = 0; slot < QUERY_FRAMES_IN_FLIGHT; slot++)
+    {
+        for (int section = 0; section < PROFILE_SECTION_COUNT; section++) m_query_frame[slot][section] = -1;
+    }
+
+    m_gpu_supported = gl_version() >= 33 || gl_has_extension("GL_ARB_timer_query");
+    if (!m_gpu_supported && !gl_has_context()) return;
+    if (!m_gpu_supported)
+    {
+        std::cout << "Profiler: no timer queries, GPU sections will stay empty" << std::endl;
+        return;
+    }
+
+    for (int slot = 0; slot < QUERY_FRAMES_IN_FLIGHT; slot++)
+    {
+        glGenQueries(PROFILE_SECTION_COUNT, m_queries[slot]);
+    }
+}
+
+void Profiler::cleanup()
+{
+    if (m_gpu_supported)
+    {
+        for (int slot = 0; slot < QUERY_FRAMES_IN_FLIGHT; slot++)
+        {
+            glDeleteQueries(PROFILE_SECTION_COUNT, m_queries[slot]);
+        }
+    }
+
+    if (m_results_dropped > 0)
+    {
+        std::cout << "Profiler: " << m_results_dropped << " GPU results were not ready in time and were dropped"
+                  << std::endl;
+    }
+}
+
+void Profiler::collect_gpu_results()
+{
+    // The slot the coming frame is about to overwrite
+    int reused_slot = (m_frame + 1) % QUERY_FRAMES_IN_FLIGHT;
+
+    for (int slot = 0; slot < QUERY_FRAMES_IN_FLIGHT; slot++)
+    {
+        for (int section = 0; section < PROFILE_SECTION_COUNT; section++)
+        {
+            int frame = m_query_frame[slot][section];
+            if (frame < 0) continue;
+
+            GLint available = 0;
+            glGetQueryObjectiv(m_queries[slot][section], GL_QUERY_RESULT_AVAILABLE, &available);
+
+            if (available)
+            {
+                GLuint64 nanoseconds = 0;
+                glGetQueryObjectui64v(m_queries[slot][section], GL_QUERY_RESULT, &nanoseconds);
+
+                // Unless the frame has already scrolled out of the history
+                if (m_frame - frame < HISTORY_FRAMES) row(frame)[section] = nanoseconds / 1000000.0f;
+                m_query_frame[slot][section] = -1;
+            }
+            else if (slot == reused_slot)
+            {
+                m_results_dropped++;
+                m_query_frame[slot][section] = -1;
+            }
+        }
+    }
+}
+
+void Profiler::begin_frame()
+{
+    if (m_gpu_supported) collect_gpu_results();
+
+    m_frame++;
+    for (int section = 0; section < PROFILE_SECTION_COUNT; section++) row(m_frame)[section] = -1.0f;
+}
+
+void Profiler::record(int section, float milliseconds)
+{
+    if (m_frame < 0) return;
+
+    row(m_frame)[section] = milliseconds;
+}
+
+void Profiler::begin_gpu(int section)
+{
+    // Timer queries of one kind cannot nest
+    if (!m_gpu_supported || m_frame < 0 || m_active_query >= 0) return;
+
+    int slot = m_frame % QUERY_FRAMES_IN_FLIGHT;
+
+    glBeginQuery(GL_TIME_ELAPSED, m_queries[slot][section]);
+    m_query_frame[slot][section] = m_frame;
+    m_active_query = section;
+}
+
+void Profiler::end_gpu()
+{
+    if (m_active_query < 0) return;
+
+    glEndQuery(GL_TIME_ELAPSED);
+    m_active_query = -1;
+}
+
+float const Profiler::get_average(int section, int frames) const
+{
+    float total = 0.0f;
+    int counted = 0;
+
+    for (int frame = m_frame; frame >= 0 && frame > m_frame - frames && m_frame - frame < HISTORY_FRAMES; frame--)
+    {
+        float value = m_history[frame % HISTORY_FRAMES][section];
+        if (value < 0.0f) continue;
+
+        total += value;
+        counted++;
+    }
+
+    return counted > 0 ? total / counted : 0.0f;
+}
+
+bool Profiler::export_csv(const char* filepath) const
+{
+    std::ofstream file(filepath);
+    if (!file)
+    {
+        std::cout << "Profiler: unable to write " << filepath << std::endl;
+        return false;
+    }
+
+    file << "frame";
+    for (int section = 0; section < PROFILE_SECTION_COUNT; section++)
+    {
+        file << "," << profile_section_name(section) << " ms";
+    }
+    file << "\n";
+
+    int first = m_frame - HISTORY_FRAMES + 1;
+    if (first < 0) first = 0;
+
+    for (int frame = first; frame <= m_frame; frame++)
+    {
+        file << frame;
+        for (int section = 0; section < PROFILE_SECTION_COUNT; section++)
+        {
+            float value = m_history[frame % HISTORY_FRAMES][section];
+
+            // Left empty rather than zero, so missing results do not skew averages
+            file << ",";
+            if (value >= 0.0f) file << value;
+        }
+        file << "\n";
+    }
+
+    std::cout << "Profiler: wrote " << m_frame - first + 1 << " frames to " << filepath << std::endl;
+    return true;
+}
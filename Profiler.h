@@ -0,0 +1,89 @@
+#pragma once
+
+#ifdef _WINDOWS
+    #include <GL/glew.h>
+#endif
+#define GL_GLEXT_PROTOTYPES 1
+#include <SDL_opengl.h>
+#include <SDL.h>
+
+enum ProfileSection
+{
+    // CPU, simulation thread
+    PROFILE_INPUT,
+    PROFILE_UPDATE,
+    PROFILE_SNAPSHOT,
+    // CPU, render thread
+    PROFILE_RENDER,
+    PROFILE_SWAP,
+    // GPU
+    PROFILE_GPU_SCENE,
+    PROFILE_GPU_HUD,
+    PROFILE_SECTION_COUNT
+};
+
+const char* profile_section_name(int section);
+
+inline float milliseconds_since(Uint64 counter)
+{
+    return (float)(SDL_GetPerformanceCounter() - counter) * 1000.0f / SDL_GetPerformanceFrequency();
+}
+
+// Times the scope it lives in and stores the result, in milliseconds, in
+// `target`. Nothing is shared, so it works on any thread.
+class ScopedTimer
+{
+private:
+    Uint64 m_start;
+    float* m_target;
+
+public:
+    ScopedTimer(float* target) : m_start(SDL_GetPerformanceCounter()), m_target(target) {}
+    ~ScopedTimer() { *m_target = milliseconds_since(m_start); }
+};
+
+// Per-frame timings for the last HISTORY_FRAMES frames, CPU and GPU side by
+// side. Owned by the render thread; simulation timings reach it through the
+// snapshot.
+//
+// GPU sections are bracketed with GL_TIME_ELAPSED queries. Results are read
+// QUERY_FRAMES_IN_FLIGHT frames later, and only once the driver says they
+// are available, so profiling never stalls the pipeline. A result that is
+// still not ready when its query is needed again is dropped, not waited for.
+class Profiler
+{
+public:
+    static const int HISTORY_FRAMES = 240;
+
+private:
+    static const int QUERY_FRAMES_IN_FLIGHT = 4;
+
+    float m_history[HISTORY_FRAMES][PROFILE_SECTION_COUNT]; // negative = no result
+    int m_frame = -1; // index of the frame being recorded
+
+    bool m_gpu_supported = false;
+    GLuint m_queries[QUERY_FRAMES_IN_FLIGHT][PROFILE_SECTION_COUNT] = {};
+    int m_query_frame[QUERY_FRAMES_IN_FLIGHT][PROFILE_SECTION_COUNT]; // -1 once read
+    int m_active_query = -1;
+    int m_results_dropped = 0;
+
+    float* const row(int frame) { return m_history[frame % HISTORY_FRAMES]; };
+    void collect_gpu_results();
+
+public:
+    void initialise();
+    void cleanup();
+
+    void begin_frame();
+    void record(int section, float milliseconds);
+    void begin_gpu(int section);
+    void end_gpu();
+
+    // Mean over the last `frames` frames that have a result for the section
+    float const get_average(int section, int frames) const;
+    int   const get_frame_count() const { return m_frame + 1; };
+    bool  const is_gpu_supported() const { return m_gpu_supported; };
+
+    // One row per frame still in the history, one column per section
+    bool export_csv(const char* filepath) const;
+};
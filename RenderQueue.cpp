@@ -0,0 +1,97 @@
+#define GL_SILENCE_DEPRECATION
+
+#include <cstring>
+#include "RenderQueue.h"
+
+unsigned long long make_render_key(int layer, int shader, GLuint texture_id, unsigned int depth)
+{
+    return ((unsigned long long)(layer & 0xff) << 56) |
+           ((unsigned long long)(depth & 0xffffff) << 32) |
+           ((unsigned long long)(shader & 0xff) << 24) |
+           (unsigned long long)(texture_id & 0xffffff);
+}
+
+int render_key_layer(unsigned long long key)
+{
+    return (int)(key >> 56);
+}
+
+int render_key_shader(unsigned long long key)
+{
+    return (int)((key >> 24) & 0xff);
+}
+
+GLuint render_key_texture(unsigned long long key)
+{
+    return (GLuint)(key & 0xffffff);
+}
+
+void RenderQueue::submit(unsigned long long key, RenderCommandKind kind, int index)
+{
+    RenderCommand command;
+    command.key = key;
+    command.kind = kind;
+    command.index = index;
+
+    m_commands.push_back(command);
+}
+
+int const RenderQueue::find_layer(int layer) const
+{
+    unsigned long long first_key = make_render_key(layer, 0, 0);
+    int low = 0, high = (int)m_commands.size();
+
+    while (low < high)
+    {
+        int middle = (low + high) / 2;
+        if (m_commands[middle].key < first_key) low = middle + 1;
+        else                                    high = middle;
+    }
+
+    return low;
+}
+
+void RenderQueue::sort()
+{
+    int count = (int)m_commands.size();
+    if (count < 2) return;
+
+    m_scratch.resize(count);
+
+    // STEP 1: Count every byte of every key in one pass
+    int counts[8][256];
+    memset(counts, 0, sizeof(counts));
+
+    for (int i = 0; i < count; i++)
+    {
+        unsigned long long key = m_commands[i].key;
+        for (int pass = 0; pass < 8; pass++) counts[pass][(key >> (pass * 8)) & 0xff]++;
+    }
+
+    // STEP 2: Scatter by each byte that varies, lowest first
+    RenderCommand* source = m_commands.data();
+    RenderCommand* destination = m_scratch.data();
+
+    for (int pass = 0; pass < 8; pass++)
+    {
+        int shift = pass * 8;
+        if (counts[pass][(source[0].key >> shift) & 0xff] == count) continue;
+
+        int offsets[256];
+        int offset = 0;
+        for (int digit = 0; digit < 256; digit++)
+        {
+            offsets[digit] = offset;
+            offset += counts[pass][digit];
+        }
+
+        for (int i = 0; i < count; i++) destination[offsets[(source[i].key >> shift) & 0xff]++] = source[i];
+
+        RenderCommand* swap = source;
+        source = destination;
+        destination = swap;
+    }
+
+    // An odd number of passes leaves the result in the scratch buffer
+    if (source != m_commands.data()) m_commands.swap(m_scratch);
+}
@@ -0,0 +1,72 @@
+#pragma once
+
+#ifdef _WINDOWS
+    #include <GL/glew.h>
+#endif
+#define GL_GLEXT_PROTOTYPES 1
+#include <SDL_opengl.h>
+#include <vector>
+
+// Coarsest draw order. Each parallax layer of the background takes its own
+// layer, counting up from LAYER_BACKGROUND, so the nearest draws last.
+enum RenderLayer
+{
+    LAYER_BACKGROUND = 0,
+    LAYER_SCENERY    = 8,
+    LAYER_ACTORS     = 9,  // this and everything after it may move between steps
+    LAYER_PARTICLES  = 10,
+    LAYER_HUD        = 11
+};
+
+const int MAX_BACKGROUND_LAYERS = LAYER_SCENERY - LAYER_BACKGROUND;
+
+enum RenderCommandKind { COMMAND_SPRITE, COMMAND_PARTICLES, COMMAND_TEXT };
+
+// What a command's 64-bit key holds, most significant first:
+//
+//   63..56  layer      draw order that must be kept
+//   55..32  depth      back to front, inside a layer
+//   31..24  shader     feature mask of the program variant
+//   23..0   texture    GL name
+//
+// Sorting by key keeps the layers in order and then, inside a layer, puts
+// everything at one depth that shares a program and a texture next to each
+// other. Layers whose content never overlaps leave depth at 0, so it can be
+// submitted in whatever order is convenient and no one has to hand-tune it
+// to save state changes. Layers whose content does overlap, like the
+// actors, number it back to front instead; neighbours that share a program
+// and a texture still end up in one batch.
+unsigned long long make_render_key(int layer, int shader, GLuint texture_id, unsigned int depth = 0);
+int    render_key_layer(unsigned long long key);
+int    render_key_shader(unsigned long long key);
+GLuint render_key_texture(unsigned long long key);
+
+struct RenderCommand
+{
+    unsigned long long key;
+    int kind;  // RenderCommandKind
+    int index; // into whatever this kind of command draws from
+};
+
+// One frame's draw commands, in a flat buffer that keeps its capacity from
+// frame to frame. Commands are radix sorted by key, a byte at a time from
+// the lowest. Each pass is stable, and a pass whose byte is the same for
+// every key is skipped, so equal keys keep their submission order and a
+// frame that uses few layers and textures costs only a couple of passes.
+class RenderQueue
+{
+private:
+    std::vector<RenderCommand> m_commands;
+    std::vector<RenderCommand> m_scratch;
+
+public:
+    void clear() { m_commands.clear(); };
+    void submit(unsigned long long key, RenderCommandKind kind, int index);
+    void sort();
+
+    // Index of the first command in `layer` or above, once sorted
+    int  const find_layer(int layer) const;
+
+    int  const get_count() const { return (int)m_commands.size(); };
+    const RenderCommand &get_command(int i) const { return m_commands[i]; };
+};
@@ -0,0 +1,123 @@
+#define GL_SILENCE_DEPRECATION
+
+#include <algorithm>
+#include <cstring>
+#include "RenderSnapshot.h"
+
+// FNV-1a
+static unsigned long long hash_bytes(unsigned long long hash, const void* data, size_t size)
+{
+    const unsigned char* bytes = (const unsigned char*)data;
+
+    for (size_t i = 0; i < size; i++)
+    {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+
+    return hash;
+}
+
+SpriteInstance const SnapshotSprite::interpolate(float alpha) const
+{
+    SpriteInstance blended = instance;
+
+    // Our sprites only ever translate and scale, so lerping the basis is exact
+    for (int i = 0; i < 2; i++) blended.position[i] += (previous.position[i] - instance.position[i]) * (1.0f - alpha);
+    for (int i = 0; i < 4; i++) blended.basis[i] += (previous.basis[i] - instance.basis[i]) * (1.0f - alpha);
+
+    return blended;
+}
+
+glm::vec2 const RenderSnapshot::camera_at(float alpha) const
+{
+    return previous_camera + (camera - previous_camera) * alpha;
+}
+
+void RenderSnapshot::clear()
+{
+    sprites.clear();
+    background.slot_tiles.clear();
+    particles.count = 0;
+    layer = LAYER_BACKGROUND;
+    shader = 0;
+    ordered = false;
+    camera = previous_camera = glm::vec2(0.0f);
+    culled = 0;
+    fuel = 0;
+    message = HUD_MESSAGE_NONE;
+    accumulator = 0.0f;
+    published_at = 0;
+    show_profiler = false;
+}
+
+unsigned long long const RenderSnapshot::static_hash() const
+{
+    unsigned long long hash = 14695981039346656037ULL;
+
+    // SnapshotSprite is a 64-bit key followed by floats, so it has no padding to skip
+    for (int i = 0; i < (int)sprites.size(); i++)
+    {
+        if (sprites[i].is_static()) hash = hash_bytes(hash, &sprites[i], sizeof(SnapshotSprite));
+    }
+    // What the background sprites sample depends on which tile is in each slot
+    if (!background.slot_tiles.empty())
+    {
+        hash = hash_bytes(hash, background.slot_tiles.data(), background.slot_tiles.size() * sizeof(int));
+    }
+
+    return hash;
+}
+
+unsigned long long const RenderSnapshot::static_hash(const glm::vec2 &camera) const
+{
+    return hash_bytes(static_hash(), &camera, sizeof(camera));
+}
+
+unsigned long long const RenderSnapshot::content_hash() const
+{
+    unsigned long long hash = static_hash();
+
+    hash = hash_bytes(hash, &camera, sizeof(camera));
+    hash = hash_bytes(hash, &previous_camera, sizeof(previous_camera));
+    // Hashing every particle would cost more than drawing them; any step that
+    // moved them changes the version instead
+    hash = hash_bytes(hash, &particles.count, sizeof(particles.count));
+    hash = hash_bytes(hash, &particles.version, sizeof(particles.version));
+
+    for (int i = 0; i < (int)sprites.size(); i++)
+    {
+        if (!sprites[i].is_static()) hash = hash_bytes(hash, &sprites[i], sizeof(SnapshotSprite));
+    }
+    hash = hash_bytes(hash, &fuel, sizeof(fuel));
+    hash = hash_bytes(hash, &message, sizeof(message));
+    hash = hash_bytes(hash, &show_profiler, sizeof(show_profiler));
+
+    return hash;
+}
+
+bool const RenderSnapshot::is_at_rest() const
+{
+    if (camera != previous_camera || particles.count > 0) return false;
+
+    for (int i = 0; i < (int)sprites.size(); i++)
+    {
+        if (memcmp(&sprites[i].previous, &sprites[i].instance, sizeof(SpriteInstance)) != 0) return false;
+    }
+
+    return true;
+}
+
+void RenderSnapshot::add_sprite(GLuint texture_id, const glm::mat4 &previous_model_matrix, const glm::mat4 &model_matrix,
+                                const glm::vec4 &uv_rect, const glm::vec4 &tint)
+{
+    // Later submissions draw over earlier ones; depth has room for 16M of them
+    unsigned int depth = ordered ? (unsigned int)std::min(sprites.size(), (size_t)0xffffff) : 0;
+
+    SnapshotSprite sprite;
+    sprite.key = make_render_key(layer, shader, texture_id, depth);
+    sprite.instance = make_sprite_instance(model_matrix, uv_rect, tint);
+    sprite.previous = make_sprite_instance(previous_model_matrix, uv_rect, tint);
+
+    sprites.push_back(sprite);
+}
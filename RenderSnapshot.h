@@ -0,0 +1,81 @@
+#pragma once
+
+#ifdef _WINDOWS
+    #include <GL/glew.h>
+#endif
+#define GL_GLEXT_PROTOTYPES 1
+#include <SDL_opengl.h>
+#include <SDL.h>
+#include <vector>
+#include "glm/mat4x4.hpp"
+#include "glm/vec2.hpp"
+#include "glm/vec4.hpp"
+#include "SpriteBatch.h"
+#include "ParallaxBackground.h"
+#include "ParticleSystem.h"
+#include "Profiler.h"
+#include "RenderQueue.h"
+
+struct SnapshotSprite
+{
+    unsigned long long key;  // see make_render_key; it carries the texture
+    SpriteInstance previous; // where the sprite was one fixed step earlier
+    SpriteInstance instance;
+
+    GLuint const get_texture_id() const { return render_key_texture(key); };
+    bool   const is_static()      const { return render_key_layer(key) < LAYER_ACTORS; };
+
+    // Blends placement only; uvs and tint snap to the latest step
+    SpriteInstance const interpolate(float alpha) const;
+};
+
+enum HudMessage { HUD_MESSAGE_NONE, HUD_MESSAGE_PARKED, HUD_MESSAGE_CRASHED };
+
+// Everything needed to draw one frame, copied out of the game state so the
+// renderer never reads entities the simulation is busy updating. Once
+// published a snapshot is never written again until the renderer hands it
+// back, and its vectors keep their capacity, so it stops allocating after
+// the first frames.
+struct RenderSnapshot
+{
+    // In submission order; the renderer sorts them by key. Those in layers
+    // under LAYER_ACTORS are static and can be cached as a picture.
+    std::vector<SnapshotSprite> sprites;
+    BackgroundFrame background;                 // tiles the background sprites expect in their pages
+    ParticleFrame particles;
+    int layer = LAYER_BACKGROUND;               // what add_sprite puts in the key besides
+    int shader = 0;                             // the texture
+    bool ordered = false;                       // and, if set, the submission order as depth
+    glm::vec2 camera = glm::vec2(0.0f);          // centre of the view, in world units
+    glm::vec2 previous_camera = glm::vec2(0.0f); // one fixed step earlier
+    int culled = 0;                             // sprites left out for being off screen
+    int fuel = 0;
+    HudMessage message = HUD_MESSAGE_NONE;
+
+    // Simulation time left over after the last step, and when it was taken;
+    // together they say how far past `instance` the renderer is
+    float accumulator = 0.0f;
+    Uint64 published_at = 0;
+
+    // Timings of the simulation-thread sections (input, update, snapshot),
+    // for the profiler on the render thread
+    float simulation_milliseconds[PROFILE_RENDER] = {};
+    bool show_profiler = false;
+
+    void clear();
+
+    // Where the camera is `alpha` of the way through the last step
+    glm::vec2 const camera_at(float alpha) const;
+
+    // Identifies what would be drawn, so a renderer can tell it has seen it before
+    unsigned long long const content_hash() const;
+    // The same, for the static sprites alone
+    unsigned long long const static_hash() const;
+    // The static sprites as seen from `camera`, for caching them as a picture
+    unsigned long long const static_hash(const glm::vec2 &camera) const;
+    // True when nothing moved in the last step, so interpolation changes nothing
+    bool const is_at_rest() const;
+
+    void add_sprite(GLuint texture_id, const glm::mat4 &previous_model_matrix, const glm::mat4 &model_matrix,
+                    const glm::vec4 &uv_rect, const glm::vec4 &tint);
+};
@@ -0,0 +1,239 @@
+#define GL_SILENCE_DEPRECATION
+
+#include <chrono>
+#include <cmath>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "stb_image.h"
+#include "GLExtensions.h"
+#include "GLState.h"
+#include "SdfFont.h"
+
+const float FAR_AWAY = 1e20f;
+
+// One pass of Felzenszwalb & Huttenlocher's exact squared distance transform:
+// the lower envelope of the parabolas rooted at every sample of f.
+static void transform_1d(const float* f, int n, float* d, int* v, float* z)
+{
+    int k = 0;
+    v[0] = 0;
+    z[0] = -FAR_AWAY;
+    z[1] = FAR_AWAY;
+
+    for (int q = 1; q < n; q++)
+    {
+        float s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2.0f * q - 2.0f * v[k]);
+        while (s <= z[k])
+        {
+            k--;
+            s = ((f[q] + q * q) - (f[v[k]] + v[k] * v[k])) / (2.0f * q - 2.0f * v[k]);
+        }
+
+        k++;
+        v[k] = q;
+        z[k] = s;
+        z[k + 1] = FAR_AWAY;
+    }
+
+    k = 0;
+    for (int q = 0; q < n; q++)
+    {
+        while (z[k + 1] < q) k++;
+        d[q] = (float)((q - v[k]) * (q - v[k])) + f[v[k]];
+    }
+}
+
+// Squared distance from every pixel to the nearest pixel where `target` is set
+static void distance_transform(const std::vector<bool> &target, int width, int height,
+                               std::vector<float> &distances)
+{
+    int longest = width > height ? width : height;
+    std::vector<float> f(longest), d(longest), z(longest + 1);
+    std::vector<int> v(longest);
+
+    distances.resize(width * height);
+    for (int i = 0; i < width * height; i++) distances[i] = target[i] ? 0.0f : FAR_AWAY;
+
+    // Columns first, then rows over the result; the 2D transform is separable
+    for (int x = 0; x < width; x++)
+    {
+        for (int y = 0; y < height; y++) f[y] = distances[y * width + x];
+        transform_1d(f.data(), height, d.data(), v.data(), z.data());
+        for (int y = 0; y < height; y++) distances[y * width + x] = d[y];
+    }
+
+    for (int y = 0; y < height; y++)
+    {
+        transform_1d(&distances[y * width], width, d.data(), v.data(), z.data());
+        for (int x = 0; x < width; x++) distances[y * width + x] = d[x];
+    }
+}
+
+// Distance in pixels to the edge of the mask; positive inside, negative outside,
+// and zero halfway between an inside pixel and its outside neighbour
+static void signed_distances(const std::vector<bool> &mask, int width, int height,
+                             std::vector<float> &distances)
+{
+    std::vector<bool> outside(mask.size());
+    for (int i = 0; i < (int)mask.size(); i++) outside[i] = !mask[i];
+
+    std::vector<float> to_inside, to_outside;
+    distance_transform(mask, width, height, to_inside);
+    distance_transform(outside, width, height, to_outside);
+
+    distances.resize(width * height);
+    for (int i = 0; i < width * height; i++)
+    {
+        distances[i] = mask[i] ? sqrtf(to_outside[i]) - 0.5f : 0.5f - sqrtf(to_inside[i]);
+    }
+}
+
+// Bilinear sample of a distance field at a position in pixel units
+static float sample(const std::vector<float> &field, int width, int height, float x, float y)
+{
+    if (x < 0.0f) x = 0.0f;
+    if (y < 0.0f) y = 0.0f;
+    if (x > width - 1.0f) x = width - 1.0f;
+    if (y > height - 1.0f) y = height - 1.0f;
+
+    int x0 = (int)x, y0 = (int)y;
+    int x1 = x0 + 1 < width ? x0 + 1 : x0;
+    int y1 = y0 + 1 < height ? y0 + 1 : y0;
+    float tx = x - x0, ty = y - y0;
+
+    float top    = field[y0 * width + x0] * (1.0f - tx) + field[y0 * width + x1] * tx;
+    float bottom = field[y1 * width + x0] * (1.0f - tx) + field[y1 * width + x1] * tx;
+
+    return top * (1.0f - ty) + bottom * ty;
+}
+
+bool SdfFont::generate(const char* font_filepath, int fontbank_size)
+{
+    start_generate(font_filepath, fontbank_size);
+    return finish_generate();
+}
+
+void SdfFont::start_generate(const char* font_filepath, int fontbank_size)
+{
+    std::string filepath = font_filepath;
+
+    m_generate_thread = std::thread([this, filepath, fontbank_size]() {
+        m_generated = build_field(filepath.c_str(), fontbank_size);
+    });
+}
+
+bool SdfFont::build_field(const char* font_filepath, int fontbank_size)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+    int width, height, number_of_components;
+    unsigned char* image = stbi_load(font_filepath, &width, &height, &number_of_components, STBI_rgb_alpha);
+
+    if (image == NULL)
+    {
+        std::cout << "Unable to load font " << font_filepath << ". Make sure the path is correct." << std::endl;
+        return false;
+    }
+
+    int cell_width = width / fontbank_size;
+    int cell_height = height / fontbank_size;
+    int texture_size = GLYPH_SIZE * fontbank_size;
+
+    std::vector<unsigned char> &texels = m_texels;
+    texels.assign(texture_size * texture_size * 2, 0);
+    std::vector<bool> fill(cell_width * cell_height), outline(cell_width * cell_height);
+    std::vector<float> fill_distances, outline_distances;
+
+    for (int glyph = 0; glyph < fontbank_size * fontbank_size; glyph++)
+    {
+        int column = glyph % fontbank_size;
+        int row = glyph / fontbank_size;
+
+        // STEP 1: Split the glyph into its white fill and the outline around it
+        for (int y = 0; y < cell_height; y++)
+        {
+            for (int x = 0; x < cell_width; x++)
+            {
+                const unsigned char* pixel = &image[((row * cell_height + y) * width + column * cell_width + x) * 4];
+
+                outline[y * cell_width + x] = pixel[3] > 127;
+                fill[y * cell_width + x] = pixel[3] > 127 && pixel[0] > 127;
+            }
+        }
+
+        // STEP 2: Exact distances at full resolution, each glyph on its own so
+        //         neighbours never leak into one another
+        signed_distances(fill, cell_width, cell_height, fill_distances);
+        signed_distances(outline, cell_width, cell_height, outline_distances);
+
+        // STEP 3: Resample into the much smaller cell, mapping [-SPREAD, SPREAD]
+        //         onto [0, 255] so the edge itself sits at 0.5
+        for (int y = 0; y < GLYPH_SIZE; y++)
+        {
+            for (int x = 0; x < GLYPH_SIZE; x++)
+            {
+                float source_x = (x + 0.5f) * cell_width / GLYPH_SIZE - 0.5f;
+                float source_y = (y + 0.5f) * cell_height / GLYPH_SIZE - 0.5f;
+
+                float fill_value = 0.5f + sample(fill_distances, cell_width, cell_height, source_x, source_y) / (2.0f * SPREAD);
+                float outline_value = 0.5f + sample(outline_distances, cell_width, cell_height, source_x, source_y) / (2.0f * SPREAD);
+
+                unsigned char* texel = &texels[((row * GLYPH_SIZE + y) * texture_size + column * GLYPH_SIZE + x) * 2];
+                texel[0] = (unsigned char)(fminf(fmaxf(fill_value, 0.0f), 1.0f) * 255.0f + 0.5f);
+                texel[1] = (unsigned char)(fminf(fmaxf(outline_value, 0.0f), 1.0f) * 255.0f + 0.5f);
+            }
+        }
+    }
+
+    stbi_image_free(image);
+
+    m_texture_size = texture_size;
+    m_bitmap_size = width * height * 4;
+    m_generate_milliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+    return true;
+}
+
+bool SdfFont::finish_generate()
+{
+    if (m_generate_thread.joinable()) m_generate_thread.join();
+    if (!m_generated) return false;
+
+    int texture_size = m_texture_size;
+
+    // Without a context the texture only needs a name for its CPU copy
+    m_texture_id = gl_gen_texture();
+    if (gl_has_context())
+    {
+        gl_bind_texture(m_texture_id);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_LUMINANCE_ALPHA, texture_size, texture_size, 0, GL_LUMINANCE_ALPHA,
+            GL_UNSIGNED_BYTE, m_texels.data());
+
+        // Distances interpolate correctly, which is the whole point
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+    }
+
+    m_region = AtlasRegion();
+    m_region.width = texture_size;
+    m_region.height = texture_size;
+    m_region.uv_rect = glm::vec4(0.0f, 0.0f, 1.0f, 1.0f);
+
+    std::cout << "SDF font: " << texture_size << "x" << texture_size << " (" << m_texels.size() / 1024
+              << " KB, bitmap was " << m_bitmap_size / 1024 << " KB), generated in "
+              << m_generate_milliseconds << " ms" << std::endl;
+
+    // The GPU copy is all we need from here on, unless asked otherwise
+    if (!m_keep_texels) std::vector<unsigned char>().swap(m_texels);
+
+    return true;
+}
+
+void SdfFont::cleanup()
+{
+    gl_delete_texture(m_texture_id);
+    m_texture_id = 0;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#ifdef _WINDOWS
+    #include <GL/glew.h>
+#endif
+#define GL_GLEXT_PROTOTYPES 1
+#include <SDL_opengl.h>
+#include <thread>
+#include <vector>
+#include "TextureAtlas.h"
+
+// Turns a bitmap font sheet into a signed-distance-field font at startup. Each
+// texel stores how far it is from a glyph edge instead of a colour, so the
+// glyphs stay sharp under linear filtering at any size and the whole font fits
+// in a small two-channel texture (see SDF_TEXT in sprite_fragment.glsl).
+//
+// Our glyphs are a white fill inside a black outline, so two fields are kept:
+// luminance holds the distance to the fill's edge and alpha the distance to the
+// outline's outer edge.
+class SdfFont
+{
+private:
+    static const int GLYPH_SIZE = 24; // texels per glyph cell in the generated texture
+    static const int SPREAD = 4;      // furthest distance stored, in source pixels
+
+    GLuint m_texture_id = 0;
+    AtlasRegion m_region;
+    bool m_keep_texels = false;
+
+    // Filled in by the generating thread, uploaded by finish_generate
+    std::thread m_generate_thread;
+    bool m_generated = false;
+    std::vector<unsigned char> m_texels;
+    int m_texture_size = 0;
+    int m_bitmap_size = 0;
+    float m_generate_milliseconds = 0.0f;
+
+    bool build_field(const char* font_filepath, int fontbank_size);
+
+public:
+    bool generate(const char* font_filepath, int fontbank_size);
+
+    // generate in two halves: the field is built on a worker thread and only
+    // the upload waits for it
+    void start_generate(const char* font_filepath, int fontbank_size);
+    bool finish_generate();
+    void cleanup();
+
+    // Keeps the field on the CPU after the upload (see SoftwareRasteriser).
+    // Call before generating.
+    void set_keep_texels(bool keep) { m_keep_texels = keep; };
+
+    GLuint const get_texture_id()   const { return m_texture_id;   };
+    int    const get_texture_size() const { return m_texture_size; };
+
+    // Luminance-alpha pairs, top row first; empty unless set_keep_texels was called
+    const std::vector<unsigned char> &get_texels() const { return m_texels; };
+
+    // Covers the whole texture, so glyphs are found with AtlasRegion::cell
+    const AtlasRegion &get_region() const { return m_region; };
+};
@@ -0,0 +1,121 @@
+#define GL_SILENCE_DEPRECATION
+
+#include "ShaderLibrary.h"
+
+struct FeatureDefine
+{
+    int feature;
+    const char* name;
+};
+
+const FeatureDefine FEATURE_DEFINES[] = {
+    { SHADER_TEXTURED,   "TEXTURED"   },
+    { SHADER_TINTED,     "TINTED"     },
+    { SHADER_INSTANCED,  "INSTANCED"  },
+    { SHADER_SDF_TEXT,   "SDF_TEXT"   },
+    { SHADER_ALPHA_TEST, "ALPHA_TEST" },
+    { SHADER_PARTICLE,   "PARTICLE"   },
+};
+
+void ShaderLibrary::load(const char* vertex_shader_file, const char* fragment_shader_file)
+{
+    m_vertex_source = ShaderProgram::read_shader_file(vertex_shader_file);
+    m_fragment_source = ShaderProgram::read_shader_file(fragment_shader_file);
+}
+
+void ShaderLibrary::cleanup()
+{
+    for (std::map<int, ShaderProgram>::iterator it = m_programs.begin(); it != m_programs.end(); ++it)
+    {
+        it->second.cleanup();
+    }
+    m_programs.clear();
+}
+
+int const ShaderLibrary::normalise(int features)
+{
+    // Distance-field text samples a texture like any other textured variant
+    if (features & SHADER_SDF_TEXT) features |= SHADER_TEXTURED;
+
+    return features;
+}
+
+std::string const ShaderLibrary::defines_for(int features)
+{
+    std::string defines;
+
+    for (int i = 0; i < (int)(sizeof(FEATURE_DEFINES) / sizeof(FEATURE_DEFINES[0])); i++)
+    {
+        if (features & FEATURE_DEFINES[i].feature)
+        {
+            defines += std::string("#define ") + FEATURE_DEFINES[i].name + " 1\n";
+        }
+    }
+
+    return defines;
+}
+
+std::string const ShaderLibrary::name_for(int features)
+{
+    std::string name;
+
+    for (int i = 0; i < (int)(sizeof(FEATURE_DEFINES) / sizeof(FEATURE_DEFINES[0])); i++)
+    {
+        if (!(features & FEATURE_DEFINES[i].feature)) continue;
+
+        if (!name.empty()) name += "|";
+        name += FEATURE_DEFINES[i].name;
+    }
+
+    return name.empty() ? "UNTEXTURED" : name;
+}
+
+void ShaderLibrary::precompile(int features)
+{
+    features = normalise(features);
+    if (m_programs.find(features) != m_programs.end()) return;
+
+    // Our sources have no #version line, so the defines can simply go first
+    std::string defines = defines_for(features);
+
+    m_programs[features].begin_load(defines + m_vertex_source, defines + m_fragment_source,
+        "variant " + name_for(features));
+}
+
+ShaderProgram* ShaderLibrary::get(int features)
+{
+    features = normalise(features);
+    precompile(features);
+
+    ShaderProgram &program = m_programs[features];
+
+    // First use is the only point that may wait on the compiler
+    if (program.is_loading())
+    {
+        program.finish_load();
+        program.set_projection_matrix(m_projection_matrix);
+        program.set_view_matrix(m_view_matrix);
+    }
+
+    return &program;
+}
+
+void ShaderLibrary::set_view_matrix(const glm::mat4 &matrix)
+{
+    m_view_matrix = matrix;
+
+    for (std::map<int, ShaderProgram>::iterator it = m_programs.begin(); it != m_programs.end(); ++it)
+    {
+        if (!it->second.is_loading()) it->second.set_view_matrix(matrix);
+    }
+}
+
+void ShaderLibrary::set_projection_matrix(const glm::mat4 &matrix)
+{
+    m_projection_matrix = matrix;
+
+    for (std::map<int, ShaderProgram>::iterator it = m_programs.begin(); it != m_programs.end(); ++it)
+    {
+        if (!it->second.is_loading()) it->second.set_projection_matrix(matrix);
+    }
+}
@@ -0,0 +1,53 @@
+#pragma once
+
+#include <map>
+#include <string>
+#include "glm/mat4x4.hpp"
+#include "ShaderProgram.h"
+
+// Feature bits of a shader variant; each one becomes a #define in front of the
+// shared sprite source
+enum ShaderFeature
+{
+    SHADER_TEXTURED   = 1 << 0,
+    SHADER_TINTED     = 1 << 1,
+    SHADER_INSTANCED  = 1 << 2,
+    SHADER_SDF_TEXT   = 1 << 3, // implies SHADER_TEXTURED
+    SHADER_ALPHA_TEST = 1 << 4,
+    SHADER_PARTICLE   = 1 << 5, // instanced from ParticleFrame's arrays, untextured
+};
+
+// Builds every shader variant from one vertex and one fragment source. A draw
+// asks for exactly the features it needs and gets a program with everything
+// else compiled out, so no variant pays for branches it never takes.
+//
+// Variants are kept by their feature mask and each lands in the program binary
+// cache on its own. precompile starts a variant compiling without waiting for
+// it; get finishes it (or compiles it outright) the first time it is needed.
+class ShaderLibrary
+{
+private:
+    std::string m_vertex_source;
+    std::string m_fragment_source;
+    std::map<int, ShaderProgram> m_programs;
+
+    // Shared by every variant, including ones compiled later
+    glm::mat4 m_view_matrix = glm::mat4(1.0f);
+    glm::mat4 m_projection_matrix = glm::mat4(1.0f);
+
+    static int const normalise(int features);
+    static std::string const defines_for(int features);
+    static std::string const name_for(int features);
+
+public:
+    void load(const char* vertex_shader_file, const char* fragment_shader_file);
+    void cleanup();
+
+    void precompile(int features);
+    ShaderProgram* get(int features);
+
+    void set_view_matrix(const glm::mat4 &matrix);
+    void set_projection_matrix(const glm::mat4 &matrix);
+
+    int const get_variant_count() const { return (int)m_programs.size(); };
+};
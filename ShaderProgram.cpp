@@ -1,48 +1,266 @@
 #define GL_SILENCE_DEPRECATION
 
+#include <chrono>
+#include <cstdio>
+#include <vector>
+#include "GLExtensions.h"
+#include "GLState.h"
 #include "ShaderProgram.h"
 
+const unsigned int PROGRAM_CACHE_MAGIC = 0x42504c4c; // "LLPB"
+const unsigned int PROGRAM_CACHE_VERSION = 1;
+const char PROGRAM_CACHE_DIRECTORY[] = "shaders/";
+
+static bool program_binaries_supported()
+{
+    static int supported = -1;
+
+    if (supported < 0)
+    {
+        // Drivers may expose the entry points but no formats to go with them
+        GLint format_count = 0;
+        if (gl_version() >= 41 || gl_has_extension("GL_ARB_get_program_binary"))
+        {
+            glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &format_count);
+        }
+        supported = format_count > 0 ? 1 : 0;
+    }
+
+    return supported == 1;
+}
+
+static void enable_parallel_compile()
+{
+    static bool enabled = false;
+    if (enabled) return;
+    enabled = true;
+
+    // Let the driver compile and link on its own threads, as many as it likes
+    if (gl_has_extension("GL_KHR_parallel_shader_compile"))
+    {
+        glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+    }
+    else if (gl_has_extension("GL_ARB_parallel_shader_compile"))
+    {
+        glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+    }
+}
+
 void ShaderProgram::load(const char *vertex_shader_file, const char *fragment_shader_file) {
     
-    // create the vertex shader
-    m_vertex_shader = load_shader_from_file(vertex_shader_file, GL_VERTEX_SHADER);
-    // create the fragment shader
-    m_fragment_shader = load_shader_from_file(fragment_shader_file, GL_FRAGMENT_SHADER);
-    
-    // Create the final shader program from our vertex and fragment shaders
+    load_from_source(read_shader_file(vertex_shader_file), read_shader_file(fragment_shader_file),
+        std::string(vertex_shader_file) + " + " + fragment_shader_file);
+}
+
+void ShaderProgram::load_from_source(const std::string &vertex_source, const std::string &fragment_source,
+                                     const std::string &name)
+{
+    begin_load(vertex_source, fragment_source, name);
+    finish_load();
+}
+
+void ShaderProgram::begin_load(const std::string &vertex_source, const std::string &fragment_source,
+                               const std::string &name)
+{
+    enable_parallel_compile();
+
+    m_pending = PendingLoad();
+    m_pending.vertex_source = vertex_source;
+    m_pending.fragment_source = fragment_source;
+    m_pending.name = name;
+    m_pending.start = std::chrono::steady_clock::now();
+
     m_program_id = glCreateProgram();
-    glAttachShader(m_program_id, m_vertex_shader);
-    glAttachShader(m_program_id, m_fragment_shader);
-    glLinkProgram(m_program_id);
-    
+    m_vertex_shader = 0;
+    m_fragment_shader = 0;
+
+    // Try the cached binary first; a new driver or edited source simply
+    // misses (or is rejected by glProgramBinary) and we compile as before
+    if (program_binaries_supported())
+    {
+        char cache_filepath[64];
+        m_pending.key = hash_sources(vertex_source, fragment_source);
+        snprintf(cache_filepath, sizeof(cache_filepath), "%s%016llx.program.cache", PROGRAM_CACHE_DIRECTORY,
+            m_pending.key);
+        m_pending.cache_filepath = cache_filepath;
+        m_pending.from_cache = load_binary(m_pending.cache_filepath, m_pending.key);
+    }
+
+    if (!m_pending.from_cache) compile_and_link(vertex_source, fragment_source);
+
+    m_loading = true;
+}
+
+void ShaderProgram::finish_load()
+{
+    if (!m_loading) return;
+    m_loading = false;
+
+    // The first status query is where we wait for the driver, if it is not
+    // done yet
     GLint link_success;
     glGetProgramiv(m_program_id, GL_LINK_STATUS, &link_success);
-    
+
+    if (link_success == GL_FALSE && m_pending.from_cache)
+    {
+        // The driver refused its own binary, e.g. after an update
+        m_pending.from_cache = false;
+        compile_and_link(m_pending.vertex_source, m_pending.fragment_source);
+        glGetProgramiv(m_program_id, GL_LINK_STATUS, &link_success);
+    }
+
     if(link_success == GL_FALSE)
     {
+        print_shader_log(m_vertex_shader);
+        print_shader_log(m_fragment_shader);
         printf("Error linking shader program!\n");
     }
+    else if (!m_pending.from_cache && program_binaries_supported())
+    {
+        save_binary(m_pending.cache_filepath, m_pending.key);
+    }
+
+    float milliseconds = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - m_pending.start).count();
+    std::cout << "Shader program " << m_pending.name
+              << (m_pending.from_cache ? ": cached binary ready after " : ": compiled and linked after ")
+              << milliseconds << " ms" << std::endl;
+
+    m_pending = PendingLoad();
     
     m_model_matrix_uniform      = glGetUniformLocation(m_program_id, "modelMatrix");
     m_projection_matrix_uniform = glGetUniformLocation(m_program_id, "projectionMatrix");
     m_view_matrix_uniform       = glGetUniformLocation(m_program_id, "viewMatrix");
     m_colour_uniform            = glGetUniformLocation(m_program_id, "color");
+    m_rewind_uniform            = glGetUniformLocation(m_program_id, "rewind");
     
     m_position_attribute  = glGetAttribLocation(m_program_id, "position");
     m_tex_coord_attribute = glGetAttribLocation(m_program_id, "texCoord");
+    m_tint_attribute      = glGetAttribLocation(m_program_id, "tint");
+
+    m_sprite_position_attribute = glGetAttribLocation(m_program_id, "spritePosition");
+    m_sprite_basis_attribute    = glGetAttribLocation(m_program_id, "spriteBasis");
+    m_sprite_uv_attribute       = glGetAttribLocation(m_program_id, "spriteUV");
+
+    const char* particle_attribute_names[PARTICLE_ATTRIBUTE_COUNT] = {
+        "particleX", "particleY", "particleVelocityX", "particleVelocityY", "particleSize", "particleAlpha"
+    };
+    for (int i = 0; i < PARTICLE_ATTRIBUTE_COUNT; i++)
+    {
+        m_particle_attributes[i] = glGetAttribLocation(m_program_id, particle_attribute_names[i]);
+    }
     
+    m_uploaded_uniforms = 0;
     set_colour(1.0f, 1.0f, 1.0f, 1.0f);
     
 }
 
 void ShaderProgram::cleanup()
 {
-    glDeleteProgram(m_program_id);
+    gl_delete_program(m_program_id);
     glDeleteShader(m_vertex_shader);
     glDeleteShader(m_fragment_shader);
 }
 
-GLuint ShaderProgram::load_shader_from_file(const std::string &shaderFile, GLenum type)
+void ShaderProgram::compile_and_link(const std::string &vertex_source, const std::string &fragment_source)
+{
+    // create the vertex shader
+    m_vertex_shader = load_shader_from_string(vertex_source, GL_VERTEX_SHADER);
+    // create the fragment shader
+    m_fragment_shader = load_shader_from_string(fragment_source, GL_FRAGMENT_SHADER);
+    
+    // Create the final shader program from our vertex and fragment shaders
+    glAttachShader(m_program_id, m_vertex_shader);
+    glAttachShader(m_program_id, m_fragment_shader);
+
+    if (program_binaries_supported())
+    {
+        glProgramParameteri(m_program_id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+
+    // Returns straight away; the result is only asked for in finish_load
+    glLinkProgram(m_program_id);
+}
+
+unsigned long long ShaderProgram::hash_sources(const std::string &vertex_source,
+                                               const std::string &fragment_source) const
+{
+    // FNV-1a over both sources and the driver's identity; binaries are only
+    // valid for the exact driver that produced them
+    unsigned long long hash = 14695981039346656037ULL;
+    const unsigned long long PRIME = 1099511628211ULL;
+
+    std::ostringstream driver;
+    driver << PROGRAM_CACHE_VERSION << ' ' << (const char*)glGetString(GL_VENDOR) << ' '
+           << (const char*)glGetString(GL_RENDERER) << ' ' << (const char*)glGetString(GL_VERSION);
+
+    std::string contents = driver.str() + '\0' + vertex_source + '\0' + fragment_source;
+    for (int i = 0; i < (int)contents.size(); i++) hash = (hash ^ (unsigned char)contents[i]) * PRIME;
+
+    return hash;
+}
+
+bool ShaderProgram::load_binary(const std::string &cache_filepath, unsigned long long key)
+{
+    std::ifstream file(cache_filepath, std::ios::binary | std::ios::ate);
+    if (file.fail()) return false;
+
+    std::streamoff file_size = file.tellg();
+    file.seekg(0);
+
+    unsigned int magic = 0, version = 0, length = 0;
+    unsigned long long cached_key = 0;
+    GLenum format = 0;
+
+    file.read((char*)&magic, sizeof(magic));
+    file.read((char*)&version, sizeof(version));
+    file.read((char*)&cached_key, sizeof(cached_key));
+    file.read((char*)&format, sizeof(format));
+    file.read((char*)&length, sizeof(length));
+
+    if (file.fail() || magic != PROGRAM_CACHE_MAGIC || version != PROGRAM_CACHE_VERSION || cached_key != key)
+    {
+        return false;
+    }
+
+    // A corrupt or foreign cache compiles from source rather than allocating what it claims
+    if (length == 0 || (std::streamoff)length > file_size - (std::streamoff)file.tellg()) return false;
+
+    std::vector<char> binary(length);
+    file.read(binary.data(), length);
+    if (file.fail()) return false;
+
+    glProgramBinary(m_program_id, format, binary.data(), (GLsizei)length);
+    return true;
+}
+
+void ShaderProgram::save_binary(const std::string &cache_filepath, unsigned long long key) const
+{
+    GLint length = 0;
+    glGetProgramiv(m_program_id, GL_PROGRAM_BINARY_LENGTH, &length);
+    if (length <= 0) return;
+
+    std::vector<char> binary(length);
+    GLenum format = 0;
+    glGetProgramBinary(m_program_id, length, NULL, &format, binary.data());
+
+    std::ofstream file(cache_filepath, std::ios::binary);
+    if (file.fail())
+    {
+        std::cout << "Unable to write shader cache " << cache_filepath << std::endl;
+        return;
+    }
+
+    unsigned int magic = PROGRAM_CACHE_MAGIC, version = PROGRAM_CACHE_VERSION, binary_length = (unsigned int)length;
+
+    file.write((const char*)&magic, sizeof(magic));
+    file.write((const char*)&version, sizeof(version));
+    file.write((const char*)&key, sizeof(key));
+    file.write((const char*)&format, sizeof(format));
+    file.write((const char*)&binary_length, sizeof(binary_length));
+    file.write(binary.data(), length);
+}
+
+std::string ShaderProgram::read_shader_file(const std::string &shaderFile)
 {
     //Open a file stream with the file name
     std::ifstream infile(shaderFile);
@@ -55,8 +273,7 @@ GLuint ShaderProgram::load_shader_from_file(const std::string &shaderFile, GLenu
     std::stringstream buffer;
     buffer << infile.rdbuf();
     
-    // Load the shader from the contents of the file
-    return load_shader_from_string(buffer.str(), type);
+    return buffer.str();
 }
 
 GLuint ShaderProgram::load_shader_from_string(const std::string &shaderContents, GLenum type)
@@ -72,42 +289,91 @@ GLuint ShaderProgram::load_shader_from_string(const std::string &shaderContents,
     glShaderSource(shaderID, 1, &shader_string, &shader_string_length);
     glCompileShader(shaderID);
     
+    // Compile errors are only checked once the program is needed, so the
+    // driver is free to compile in the background until then
+    return shaderID;
+}
+
+void ShaderProgram::print_shader_log(GLuint shader)
+{
+    if (shader == 0) return;
+
     // Check if the shader compiled properly
     GLint compile_success;
-    glGetShaderiv(shaderID, GL_COMPILE_STATUS, &compile_success);
+    glGetShaderiv(shader, GL_COMPILE_STATUS, &compile_success);
     
     // If the shader did not compile, print the error to stdout
     if (compile_success == GL_FALSE)
     {
         GLchar messages[512];
-        glGetShaderInfoLog(shaderID, sizeof(messages), 0, &messages[0]);
+        glGetShaderInfoLog(shader, sizeof(messages), 0, &messages[0]);
         std::cout << messages << std::endl;
     }
-    
-    // return the shader id
-    return shaderID;
 }
 
 void ShaderProgram::set_colour(float red, float green, float blue, float alpha)
 {
-    glUseProgram(m_program_id);
+    glm::vec4 colour = glm::vec4(red, green, blue, alpha);
+
+    bool skipped = (m_uploaded_uniforms & COLOUR_UPLOADED) && m_colour == colour;
+    gl_count_call(skipped);
+    if (skipped) return;
+
+    m_colour = colour;
+    m_uploaded_uniforms |= COLOUR_UPLOADED;
+
+    gl_use_program(m_program_id);
     glUniform4f(m_colour_uniform, red, green, blue, alpha);
 }
 
+void ShaderProgram::set_rewind(float seconds)
+{
+    bool skipped = (m_uploaded_uniforms & REWIND_UPLOADED) && m_rewind == seconds;
+    gl_count_call(skipped);
+    if (skipped) return;
+
+    m_rewind = seconds;
+    m_uploaded_uniforms |= REWIND_UPLOADED;
+
+    gl_use_program(m_program_id);
+    glUniform1f(m_rewind_uniform, seconds);
+}
+
 void ShaderProgram::set_view_matrix(const glm::mat4 &matrix)
 {
-    glUseProgram(m_program_id);
+    bool skipped = (m_uploaded_uniforms & VIEW_MATRIX_UPLOADED) && m_view_matrix == matrix;
+    gl_count_call(skipped);
+    if (skipped) return;
+
+    m_view_matrix = matrix;
+    m_uploaded_uniforms |= VIEW_MATRIX_UPLOADED;
+
+    gl_use_program(m_program_id);
     glUniformMatrix4fv(m_view_matrix_uniform, 1, GL_FALSE, &matrix[0][0]);
 }
 
 void ShaderProgram::set_model_matrix(const glm::mat4 &matrix)
 {
-    glUseProgram(m_program_id);
+    bool skipped = (m_uploaded_uniforms & MODEL_MATRIX_UPLOADED) && m_model_matrix == matrix;
+    gl_count_call(skipped);
+    if (skipped) return;
+
+    m_model_matrix = matrix;
+    m_uploaded_uniforms |= MODEL_MATRIX_UPLOADED;
+
+    gl_use_program(m_program_id);
     glUniformMatrix4fv(m_model_matrix_uniform, 1, GL_FALSE, &matrix[0][0]);
 }
 
 void ShaderProgram::set_projection_matrix(const glm::mat4 &matrix)
 {
-    glUseProgram(m_program_id);
+    bool skipped = (m_uploaded_uniforms & PROJECTION_MATRIX_UPLOADED) && m_projection_matrix == matrix;
+    gl_count_call(skipped);
+    if (skipped) return;
+
+    m_projection_matrix = matrix;
+    m_uploaded_uniforms |= PROJECTION_MATRIX_UPLOADED;
+
+    gl_use_program(m_program_id);
     glUniformMatrix4fv(m_projection_matrix_uniform, 1, GL_FALSE, &matrix[0][0]);
 }
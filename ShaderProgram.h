@@ -9,15 +9,29 @@
 #include <iostream>
 #include <fstream>
 #include <sstream>
+#include <chrono>
 #include "glm/mat4x4.hpp"
+#include "glm/vec4.hpp"
+
+// Per-instance attributes of the PARTICLE variant, one array each
+enum ParticleAttribute
+{
+    PARTICLE_X, PARTICLE_Y, PARTICLE_VELOCITY_X, PARTICLE_VELOCITY_Y, PARTICLE_SIZE, PARTICLE_ALPHA,
+    PARTICLE_ATTRIBUTE_COUNT
+};
 
 class ShaderProgram
 {
 private:
-    void cleanup();
-    
     GLuint load_shader_from_string(const std::string &shader_contents, GLenum shader_type);
-    GLuint load_shader_from_file(const std::string &shader_file, GLenum shader_type);
+    void print_shader_log(GLuint shader);
+
+    // Linked programs are cached as driver binaries, keyed by the sources and
+    // the driver, so later launches skip compiling and linking altogether
+    unsigned long long hash_sources(const std::string &vertex_source, const std::string &fragment_source) const;
+    bool load_binary(const std::string &cache_filepath, unsigned long long key);
+    void save_binary(const std::string &cache_filepath, unsigned long long key) const;
+    void compile_and_link(const std::string &vertex_source, const std::string &fragment_source);
 
     GLuint m_program_id;
 
@@ -25,25 +39,81 @@ private:
     GLuint m_model_matrix_uniform;
     GLuint m_view_matrix_uniform;
     GLuint m_colour_uniform;
+    GLuint m_rewind_uniform;
 
     GLuint m_position_attribute;
     GLuint m_tex_coord_attribute;
+    GLuint m_tint_attribute;
+
+    // Only present in the instanced sprite shader
+    GLuint m_sprite_position_attribute;
+    GLuint m_sprite_basis_attribute;
+    GLuint m_sprite_uv_attribute;
+
+    // Only present in the particle shader
+    GLuint m_particle_attributes[PARTICLE_ATTRIBUTE_COUNT];
 
     GLuint m_vertex_shader;
     GLuint m_fragment_shader;
+
+    // Everything finish_load needs from begin_load; the sources are kept in
+    // case the driver rejects our cached binary
+    struct PendingLoad
+    {
+        std::string vertex_source;
+        std::string fragment_source;
+        std::string name;
+        std::string cache_filepath;
+        unsigned long long key = 0;
+        bool from_cache = false;
+        std::chrono::steady_clock::time_point start;
+    };
+
+    PendingLoad m_pending;
+    bool m_loading = false;
+
+    // Last values uploaded, so unchanged uniforms are never sent again
+    enum { MODEL_MATRIX_UPLOADED = 1, VIEW_MATRIX_UPLOADED = 2, PROJECTION_MATRIX_UPLOADED = 4, COLOUR_UPLOADED = 8,
+           REWIND_UPLOADED = 16 };
+    int m_uploaded_uniforms = 0;
+    glm::mat4 m_model_matrix;
+    glm::mat4 m_view_matrix;
+    glm::mat4 m_projection_matrix;
+    glm::vec4 m_colour;
+    float m_rewind = 0.0f;
     
 public:
 
     void load(const char *vertex_shader_file, const char *fragment_shader_file);
+    void load_from_source(const std::string &vertex_source, const std::string &fragment_source,
+                          const std::string &name);
+
+    // load_from_source in two halves: begin_load hands the work to the driver
+    // and returns; finish_load waits for it (if it must) and looks up the
+    // uniforms. Nothing may be drawn with the program in between.
+    void begin_load(const std::string &vertex_source, const std::string &fragment_source,
+                    const std::string &name);
+    void finish_load();
+    void cleanup();
+
+    static std::string read_shader_file(const std::string &shader_file);
 
     void set_model_matrix(const glm::mat4 &matrix);
     void set_projection_matrix(const glm::mat4 &matrix);
     void set_view_matrix(const glm::mat4 &matrix);
     void set_colour(float red, float green, float blue, float alpha);
+    void set_rewind(float seconds);
     
     GLuint const get_program_id()               const { return m_program_id;          };
     GLuint const get_position_attribute()       const { return m_position_attribute;  };
     GLuint const get_tex_coordinate_attribute() const { return m_tex_coord_attribute; };
+    GLuint const get_tint_attribute()           const { return m_tint_attribute;      };
+    GLuint const get_sprite_position_attribute() const { return m_sprite_position_attribute; };
+    GLuint const get_sprite_basis_attribute()    const { return m_sprite_basis_attribute;    };
+    GLuint const get_sprite_uv_attribute()       const { return m_sprite_uv_attribute;       };
+    GLuint const get_particle_attribute(int attribute) const { return m_particle_attributes[attribute]; };
+    bool   const is_loading()                    const { return m_loading; };
+    bool   const is_instanced()                  const { return m_sprite_position_attribute != (GLuint)-1; };
     
     void set_program_id(GLuint program_id)                         { m_program_id = program_id;                   };
 };
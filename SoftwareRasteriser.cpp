@@ -0,0 +1,599 @@
+#define GL_SILENCE_DEPRECATION
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include "SoftwareRasteriser.h"
+
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define RASTERISER_SSE2 1
+#endif
+
+static const unsigned short WHITE[4] = { 255, 255, 255, 255 };
+
+// ––––– BLENDING ––––– //
+// colour = texel * tint, then destination = colour * a + destination * (1 - a),
+// all in 0..255 integers. Every product fits in 16 bits, and x / 255 is
+// rounded exactly by (x + 128 + ((x + 128) >> 8)) >> 8.
+
+static inline int divide_by_255(int x)
+{
+    x += 128;
+    return (x + (x >> 8)) >> 8;
+}
+
+static inline void blend_pixel(unsigned char* destination, const unsigned char* texel, const unsigned short* tint)
+{
+    int colour[4];
+    for (int i = 0; i < 4; i++) colour[i] = divide_by_255(texel[i] * tint[i]);
+
+    int alpha = colour[3];
+    for (int i = 0; i < 4; i++) destination[i] = (unsigned char)divide_by_255(colour[i] * alpha + destination[i] * (255 - alpha));
+}
+
+#ifdef RASTERISER_SSE2
+static inline __m128i divide_by_255(__m128i x)
+{
+    x = _mm_add_epi16(x, _mm_set1_epi16(128));
+    return _mm_srli_epi16(_mm_add_epi16(x, _mm_srli_epi16(x, 8)), 8);
+}
+
+// Two pixels, one channel per 16-bit lane
+static inline __m128i blend_pixels(__m128i destination, __m128i texels, __m128i tint)
+{
+    __m128i colour = divide_by_255(_mm_mullo_epi16(texels, tint));
+    __m128i alpha = _mm_shufflehi_epi16(_mm_shufflelo_epi16(colour, _MM_SHUFFLE(3, 3, 3, 3)), _MM_SHUFFLE(3, 3, 3, 3));
+    __m128i inverse_alpha = _mm_sub_epi16(_mm_set1_epi16(255), alpha);
+
+    return divide_by_255(_mm_add_epi16(_mm_mullo_epi16(colour, alpha), _mm_mullo_epi16(destination, inverse_alpha)));
+}
+#endif
+
+static void blend_span(unsigned char* destination, const unsigned char* texels, int count, const unsigned short* tint)
+{
+    int i = 0;
+
+#ifdef RASTERISER_SSE2
+    // Four pixels per iteration: widen to 16 bits, blend, narrow back
+    __m128i zero = _mm_setzero_si128();
+    __m128i tint_lanes = _mm_setr_epi16(tint[0], tint[1], tint[2], tint[3], tint[0], tint[1], tint[2], tint[3]);
+
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128i source = _mm_loadu_si128((const __m128i*)&texels[i * 4]);
+        __m128i target = _mm_loadu_si128((const __m128i*)&destination[i * 4]);
+
+        __m128i low = blend_pixels(_mm_unpacklo_epi8(target, zero), _mm_unpacklo_epi8(source, zero), tint_lanes);
+        __m128i high = blend_pixels(_mm_unpackhi_epi8(target, zero), _mm_unpackhi_epi8(source, zero), tint_lanes);
+
+        _mm_storeu_si128((__m128i*)&destination[i * 4], _mm_packus_epi16(low, high));
+    }
+#endif
+
+    for (; i < count; i++) blend_pixel(&destination[i * 4], &texels[i * 4], tint);
+}
+
+// ––––– SAMPLING ––––– //
+
+// Narrows [first, last) to the pixels x where -0.5 <= value + step * x < 0.5
+static void clip_span(float value, float step, int* first, int* last)
+{
+    if (step == 0.0f)
+    {
+        if (value < -0.5f || value >= 0.5f) *last = *first;
+        return;
+    }
+
+    float low = (-0.5f - value) / step;
+    float high = (0.5f - value) / step;
+    float from, to;
+
+    if (step > 0.0f) { from = ceilf(low);        to = ceilf(high);       }
+    else             { from = floorf(high) + 1;  to = floorf(low) + 1;   }
+
+    // Clamped as floats first; a nearly edge-on quad can put these anywhere
+    if (from > (float)*first) *first = from < (float)*last ? (int)from : *last;
+    if (to < (float)*last)    *last = to > (float)*first ? (int)to : *first;
+}
+
+static inline int clamp_texel(float coordinate, int size)
+{
+    if (coordinate <= 0.0f) return 0;
+
+    int texel = (int)coordinate;
+    return texel < size ? texel : size - 1;
+}
+
+// Bilinear .r and .a at a position in texels, clamped to the edge, and how
+// fast .a changes along x and y there
+static void sample_bilinear(const unsigned char* pixels, int width, int height, float x, float y,
+                            float* red, float* alpha, float* alpha_dx, float* alpha_dy)
+{
+    x -= 0.5f;
+    y -= 0.5f;
+    if (x < 0.0f) x = 0.0f;
+    if (y < 0.0f) y = 0.0f;
+    if (x > width - 1.0f) x = width - 1.0f;
+    if (y > height - 1.0f) y = height - 1.0f;
+
+    int x0 = (int)x, y0 = (int)y;
+    int x1 = x0 + 1 < width ? x0 + 1 : x0;
+    int y1 = y0 + 1 < height ? y0 + 1 : y0;
+    float tx = x - x0, ty = y - y0;
+
+    const unsigned char* corners[4] = {
+        &pixels[(y0 * width + x0) * 4], &pixels[(y0 * width + x1) * 4],
+        &pixels[(y1 * width + x0) * 4], &pixels[(y1 * width + x1) * 4]
+    };
+    float weights[4] = { (1 - tx) * (1 - ty), tx * (1 - ty), (1 - tx) * ty, tx * ty };
+
+    *red = *alpha = 0.0f;
+    for (int i = 0; i < 4; i++)
+    {
+        *red += corners[i][0] * weights[i];
+        *alpha += corners[i][3] * weights[i];
+    }
+    *red /= 255.0f;
+    *alpha /= 255.0f;
+
+    *alpha_dx = ((corners[1][3] - corners[0][3]) * (1 - ty) + (corners[3][3] - corners[2][3]) * ty) / 255.0f;
+    *alpha_dy = ((corners[2][3] - corners[0][3]) * (1 - tx) + (corners[3][3] - corners[1][3]) * tx) / 255.0f;
+}
+
+// Bilinear RGBA, 0..255, at a position in texels, clamped to the edge
+static void sample_linear(const unsigned char* pixels, int width, int height, float x, float y, float* rgba)
+{
+    x = std::min(std::max(x - 0.5f, 0.0f), width - 1.0f);
+    y = std::min(std::max(y - 0.5f, 0.0f), height - 1.0f);
+
+    int x0 = (int)x, y0 = (int)y;
+    int x1 = x0 + 1 < width ? x0 + 1 : x0;
+    int y1 = y0 + 1 < height ? y0 + 1 : y0;
+    float tx = x - x0, ty = y - y0;
+
+    const unsigned char* corners[4] = {
+        &pixels[((size_t)y0 * width + x0) * 4], &pixels[((size_t)y0 * width + x1) * 4],
+        &pixels[((size_t)y1 * width + x0) * 4], &pixels[((size_t)y1 * width + x1) * 4]
+    };
+    float weights[4] = { (1 - tx) * (1 - ty), tx * (1 - ty), (1 - tx) * ty, tx * ty };
+
+    for (int c = 0; c < 4; c++)
+    {
+        rgba[c] = corners[0][c] * weights[0] + corners[1][c] * weights[1] + corners[2][c] * weights[2] + corners[3][c] * weights[3];
+    }
+}
+
+static float smoothstep(float edge0, float edge1, float x)
+{
+    if (edge1 <= edge0) return x < edge0 ? 0.0f : 1.0f;
+
+    float t = std::min(std::max((x - edge0) / (edge1 - edge0), 0.0f), 1.0f);
+    return t * t * (3.0f - 2.0f * t);
+}
+
+// ––––– SETUP ––––– //
+
+void SoftwareRasteriser::initialise(int width, int height)
+{
+    m_width = width;
+    m_height = height;
+    m_tiles_across = (width + TILE_SIZE - 1) / TILE_SIZE;
+    m_tiles_down = (height + TILE_SIZE - 1) / TILE_SIZE;
+
+    m_pixels.assign((size_t)width * height * 4, 0);
+    m_static_pixels.assign((size_t)width * height * 4, 0);
+    m_bins.resize(m_tiles_across * m_tiles_down);
+    m_static_valid = false;
+
+    // Texture 0, like GL's, is there for quads drawn without one
+    const unsigned char white[4] = { 255, 255, 255, 255 };
+    add_texture(UNTEXTURED, 1, 1, white);
+
+    // The calling thread takes tiles too, so it gets no worker of its own
+    int worker_count = std::min((int)std::thread::hardware_concurrency(), m_tiles_across * m_tiles_down) - 1;
+    m_stopping = false;
+    for (int i = 0; i < worker_count; i++) m_workers.push_back(std::thread(&SoftwareRasteriser::worker_main, this));
+}
+
+void SoftwareRasteriser::cleanup()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_work_ready.notify_all();
+
+    for (int i = 0; i < (int)m_workers.size(); i++) m_workers[i].join();
+    m_workers.clear();
+
+    m_textures.clear();
+    m_quads.clear();
+    m_bins.clear();
+    std::vector<unsigned char>().swap(m_pixels);
+    std::vector<unsigned char>().swap(m_static_pixels);
+}
+
+void SoftwareRasteriser::add_texture(GLuint texture_id, int width, int height, const unsigned char* rgba)
+{
+    Texture &texture = m_textures[texture_id];
+    texture.width = width;
+    texture.height = height;
+    texture.pixels.assign(rgba, rgba + (size_t)width * height * 4);
+}
+
+void SoftwareRasteriser::update_texture(GLuint texture_id, int x, int y, int width, int height,
+                                        const unsigned char* rgba)
+{
+    std::map<GLuint, Texture>::iterator texture = m_textures.find(texture_id);
+    if (texture == m_textures.end()) return;
+
+    for (int row = 0; row < height; row++)
+    {
+        memcpy(&texture->second.pixels[((size_t)(y + row) * texture->second.width + x) * 4],
+            &rgba[(size_t)row * width * 4], (size_t)width * 4);
+    }
+}
+
+void SoftwareRasteriser::add_mip_level(GLuint texture_id, int width, int height, const unsigned char* rgba)
+{
+    std::map<GLuint, Texture>::iterator texture = m_textures.find(texture_id);
+    if (texture == m_textures.end()) return;
+
+    Level level;
+    level.width = width;
+    level.height = height;
+    level.pixels.assign(rgba, rgba + (size_t)width * height * 4);
+    texture->second.mips.push_back(level);
+}
+
+void SoftwareRasteriser::set_filters(GLuint texture_id, GLenum min_filter, GLenum mag_filter)
+{
+    std::map<GLuint, Texture>::iterator texture = m_textures.find(texture_id);
+    if (texture == m_textures.end()) return;
+
+    texture->second.min_filter = min_filter;
+    texture->second.mag_filter = mag_filter;
+}
+
+void SoftwareRasteriser::add_luminance_alpha_texture(GLuint texture_id, int width, int height,
+                                                     const unsigned char* texels)
+{
+    // Expanded the way GL reads GL_LUMINANCE_ALPHA: (L, L, L, A)
+    Texture &texture = m_textures[texture_id];
+    texture.width = width;
+    texture.height = height;
+    texture.pixels.resize((size_t)width * height * 4);
+
+    for (size_t i = 0; i < (size_t)width * height; i++)
+    {
+        texture.pixels[i * 4 + 0] = texture.pixels[i * 4 + 1] = texture.pixels[i * 4 + 2] = texels[i * 2];
+        texture.pixels[i * 4 + 3] = texels[i * 2 + 1];
+    }
+}
+
+void SoftwareRasteriser::set_clear_colour(float red, float green, float blue, float alpha)
+{
+    float colour[4] = { red, green, blue, alpha };
+    unsigned char bytes[4];
+
+    for (int i = 0; i < 4; i++) bytes[i] = (unsigned char)(std::min(std::max(colour[i], 0.0f), 1.0f) * 255.0f + 0.5f);
+
+    memcpy(&m_clear_pixel, bytes, 4);
+    m_static_valid = false;
+}
+
+// ––––– DRAWING ––––– //
+
+bool SoftwareRasteriser::begin_frame(unsigned long long static_key)
+{
+    m_quads.clear();
+    for (int i = 0; i < (int)m_bins.size(); i++) m_bins[i].clear();
+
+    m_static_cached = m_static_valid && static_key == m_static_key;
+    m_static_key = static_key;
+    m_static_end = 0;
+
+    return m_static_cached;
+}
+
+void SoftwareRasteriser::end_static()
+{
+    m_static_end = (int)m_quads.size();
+}
+
+void SoftwareRasteriser::draw_sprite(GLuint texture_id, const SpriteInstance &instance)
+{
+    add_quad(texture_id, instance, QUAD_SPRITE);
+}
+
+void SoftwareRasteriser::draw_text(GLuint texture_id, const SpriteInstance &glyph)
+{
+    add_quad(texture_id, glyph, QUAD_SDF_TEXT);
+}
+
+void SoftwareRasteriser::add_quad(GLuint texture_id, const SpriteInstance &instance, QuadKind kind)
+{
+    std::map<GLuint, Texture>::const_iterator texture = m_textures.find(texture_id);
+    if (texture == m_textures.end()) return;
+
+    // STEP 1: Centre and edge vectors in pixels, rows counted from the top
+    float half_width = m_width * 0.5f, half_height = m_height * 0.5f;
+    const glm::mat4 &m = m_matrix;
+
+    float world[3][2] = {
+        { instance.position[0], instance.position[1] },
+        { instance.basis[0], instance.basis[1] },
+        { instance.basis[2], instance.basis[3] }
+    };
+    float screen[3][2];
+    for (int i = 0; i < 3; i++)
+    {
+        float translate = i == 0 ? 1.0f : 0.0f; // edges are directions
+        screen[i][0] = (m[0][0] * world[i][0] + m[1][0] * world[i][1] + m[3][0] * translate) * half_width;
+        screen[i][1] = -(m[0][1] * world[i][0] + m[1][1] * world[i][1] + m[3][1] * translate) * half_height;
+    }
+    screen[0][0] += half_width;
+    screen[0][1] += half_height;
+
+    float determinant = screen[1][0] * screen[2][1] - screen[2][0] * screen[1][1];
+    if (fabsf(determinant) < 1e-6f) return;
+
+    // STEP 2: Invert the mapping, so each pixel can find where it is on the quad
+    Quad quad;
+    quad.texture = &texture->second;
+    quad.kind = kind;
+    quad.s[1] = screen[2][1] / determinant;
+    quad.s[2] = -screen[2][0] / determinant;
+    quad.s[0] = -(quad.s[1] * screen[0][0] + quad.s[2] * screen[0][1]);
+    quad.t[1] = -screen[1][1] / determinant;
+    quad.t[2] = screen[1][0] / determinant;
+    quad.t[0] = -(quad.t[1] * screen[0][0] + quad.t[2] * screen[0][1]);
+
+    // As GL picks a level: the larger of the texel footprints of a step across and a step down
+    float u_scale = (instance.uv_rect[2] - instance.uv_rect[0]) * texture->second.width;
+    float v_scale = (instance.uv_rect[1] - instance.uv_rect[3]) * texture->second.height;
+    float footprint_x = hypotf(quad.s[1] * u_scale, quad.t[1] * v_scale);
+    float footprint_y = hypotf(quad.s[2] * u_scale, quad.t[2] * v_scale);
+    quad.lod = log2f(std::max(std::max(footprint_x, footprint_y), 1e-6f));
+
+    for (int i = 0; i < 4; i++)
+    {
+        quad.uv_rect[i] = instance.uv_rect[i];
+        quad.tint[i] = instance.tint[i];
+        quad.tint_bytes[i] = (unsigned short)(std::min(std::max(instance.tint[i], 0.0f), 1.0f) * 255.0f + 0.5f);
+    }
+
+    // STEP 3: Screen bounds from the four corners
+    float extent_x = (fabsf(screen[1][0]) + fabsf(screen[2][0])) * 0.5f;
+    float extent_y = (fabsf(screen[1][1]) + fabsf(screen[2][1])) * 0.5f;
+
+    quad.min_x = std::max((int)floorf(screen[0][0] - extent_x), 0);
+    quad.min_y = std::max((int)floorf(screen[0][1] - extent_y), 0);
+    quad.max_x = std::min((int)ceilf(screen[0][0] + extent_x), m_width);
+    quad.max_y = std::min((int)ceilf(screen[0][1] + extent_y), m_height);
+    if (quad.min_x >= quad.max_x || quad.min_y >= quad.max_y) return;
+
+    // STEP 4: Bin it into every tile it touches
+    int index = (int)m_quads.size();
+    m_quads.push_back(quad);
+
+    for (int tile_y = quad.min_y / TILE_SIZE; tile_y <= (quad.max_y - 1) / TILE_SIZE; tile_y++)
+    {
+        for (int tile_x = quad.min_x / TILE_SIZE; tile_x <= (quad.max_x - 1) / TILE_SIZE; tile_x++)
+        {
+            m_bins[tile_y * m_tiles_across + tile_x].push_back(index);
+        }
+    }
+}
+
+void SoftwareRasteriser::end_frame()
+{
+    m_next_tile = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_workers_busy = (int)m_workers.size();
+        m_generation++;
+    }
+    m_work_ready.notify_all();
+
+    rasterise_tiles();
+
+    {
+        std::unique_lock<std::mutex> lock(m_mutex);
+        m_work_done.wait(lock, [this]() { return m_workers_busy == 0; });
+    }
+
+    // Every tile has stored its part of a freshly drawn static layer
+    m_static_valid = true;
+}
+
+// ––––– WORKERS ––––– //
+
+void SoftwareRasteriser::worker_main()
+{
+    int generation = 0;
+
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_work_ready.wait(lock, [this, generation]() { return m_stopping || m_generation != generation; });
+            if (m_stopping) return;
+            generation = m_generation;
+        }
+
+        rasterise_tiles();
+
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (--m_workers_busy == 0) m_work_done.notify_one();
+    }
+}
+
+void SoftwareRasteriser::rasterise_tiles()
+{
+    int tile_count = (int)m_bins.size();
+
+    for (int tile = m_next_tile++; tile < tile_count; tile = m_next_tile++) rasterise_tile(tile);
+}
+
+void SoftwareRasteriser::rasterise_tile(int tile)
+{
+    int x0 = (tile % m_tiles_across) * TILE_SIZE;
+    int y0 = (tile / m_tiles_across) * TILE_SIZE;
+    int x1 = std::min(x0 + TILE_SIZE, m_width);
+    int y1 = std::min(y0 + TILE_SIZE, m_height);
+    size_t row_size = (size_t)(x1 - x0) * 4;
+
+    const std::vector<int> &bin = m_bins[tile];
+    int next = 0;
+
+    // STEP 1: Start from the static layer; if it is new, draw it and keep it
+    if (m_static_cached)
+    {
+        for (int y = y0; y < y1; y++)
+        {
+            size_t offset = ((size_t)y * m_width + x0) * 4;
+            memcpy(&m_pixels[offset], &m_static_pixels[offset], row_size);
+        }
+
+        while (next < (int)bin.size() && bin[next] < m_static_end) next++;
+    }
+    else
+    {
+        for (int y = y0; y < y1; y++)
+        {
+            unsigned char* row = &m_pixels[((size_t)y * m_width + x0) * 4];
+            for (int x = 0; x < x1 - x0; x++) memcpy(&row[x * 4], &m_clear_pixel, 4);
+        }
+
+        for (; next < (int)bin.size() && bin[next] < m_static_end; next++)
+        {
+            rasterise_quad(m_quads[bin[next]], x0, y0, x1, y1);
+        }
+
+        for (int y = y0; y < y1; y++)
+        {
+            size_t offset = ((size_t)y * m_width + x0) * 4;
+            memcpy(&m_static_pixels[offset], &m_pixels[offset], row_size);
+        }
+    }
+
+    // STEP 2: Then everything that moves, in draw order
+    for (; next < (int)bin.size(); next++) rasterise_quad(m_quads[bin[next]], x0, y0, x1, y1);
+}
+
+void SoftwareRasteriser::rasterise_quad(const Quad &quad, int tile_x0, int tile_y0, int tile_x1, int tile_y1)
+{
+    const Texture &texture = *quad.texture;
+    unsigned char texels[TILE_SIZE * 4];
+
+    // Texel coordinates move by a fixed amount per pixel across and down
+    float u_scale = (quad.uv_rect[2] - quad.uv_rect[0]) * texture.width;
+    float v_scale = (quad.uv_rect[1] - quad.uv_rect[3]) * texture.height;
+    float u_step = quad.s[1] * u_scale, v_step = quad.t[1] * v_scale;
+    float u_step_down = quad.s[2] * u_scale, v_step_down = quad.t[2] * v_scale;
+
+    int first_row = std::max(tile_y0, quad.min_y), last_row = std::min(tile_y1, quad.max_y);
+
+    for (int y = first_row; y < last_row; y++)
+    {
+        // STEP 1: Where the quad starts and stops on this row
+        float s_row = quad.s[0] + quad.s[2] * (y + 0.5f) + quad.s[1] * 0.5f;
+        float t_row = quad.t[0] + quad.t[2] * (y + 0.5f) + quad.t[1] * 0.5f;
+
+        int first = std::max(tile_x0, quad.min_x), last = std::min(tile_x1, quad.max_x);
+        clip_span(s_row, quad.s[1], &first, &last);
+        clip_span(t_row, quad.t[1], &first, &last);
+        if (first >= last) continue;
+
+        float s = s_row + quad.s[1] * first;
+        float t = t_row + quad.t[1] * first;
+        float u = (quad.uv_rect[0] * texture.width) + (s + 0.5f) * u_scale;
+        float v = (quad.uv_rect[3] * texture.height) + (t + 0.5f) * v_scale;
+
+        int count = last - first;
+        unsigned char* destination = &m_pixels[((size_t)y * m_width + first) * 4];
+
+        // STEP 2: Fetch the span's colours, then blend them all at once
+        if (quad.kind == QUAD_SPRITE)
+        {
+            GLenum filter = quad.lod > 0.0f ? texture.min_filter : texture.mag_filter;
+
+            if (filter == GL_NEAREST)
+            {
+                for (int i = 0; i < count; i++, u += u_step, v += v_step)
+                {
+                    int texel = clamp_texel(v, texture.height) * texture.width + clamp_texel(u, texture.width);
+                    memcpy(&texels[i * 4], &texture.pixels[(size_t)texel * 4], 4);
+                }
+            }
+            else
+            {
+                for (int i = 0; i < count; i++, u += u_step, v += v_step)
+                {
+                    sample_filtered(texture, filter, quad.lod, u, v, &texels[i * 4]);
+                }
+            }
+
+            blend_span(destination, texels, count, quad.tint_bytes);
+        }
+        else
+        {
+            // As in SDF_TEXT: anti-alias over one pixel. fwidth comes from the
+            // field's own gradient, carried through the texels-per-pixel steps.
+            for (int i = 0; i < count; i++, u += u_step, v += v_step)
+            {
+                float field_r, field_a, field_du, field_dv;
+                sample_bilinear(texture.pixels.data(), texture.width, texture.height, u, v,
+                    &field_r, &field_a, &field_du, &field_dv);
+
+                float width = fabsf(field_du * u_step + field_dv * v_step)
+                            + fabsf(field_du * u_step_down + field_dv * v_step_down);
+                float smoothing = 0.7f * width;
+                float fill = smoothstep(0.5f - smoothing, 0.5f + smoothing, field_r);
+                float outline = smoothstep(0.5f - smoothing, 0.5f + smoothing, field_a);
+                float colour[4] = { fill, fill, fill, outline };
+
+                for (int c = 0; c < 4; c++) texels[i * 4 + c] = (unsigned char)(colour[c] * quad.tint[c] * 255.0f + 0.5f);
+            }
+
+            blend_span(destination, texels, count, WHITE);
+        }
+    }
+}
+
+// GL_LINEAR, or GL_LINEAR_MIPMAP_LINEAR between the two levels either side
+// of `lod`; (u, v) is in level 0 texels
+void SoftwareRasteriser::sample_filtered(const Texture &texture, GLenum filter, float lod, float u, float v,
+                                         unsigned char* texel)
+{
+    int level = 0;
+    float blend = 0.0f;
+
+    if (filter == GL_LINEAR_MIPMAP_LINEAR && lod > 0.0f && !texture.mips.empty())
+    {
+        float clamped = std::min(lod, (float)texture.mips.size());
+        level = (int)clamped;
+        blend = clamped - level;
+    }
+
+    float colour[4], next[4];
+    for (int l = level; l <= level + 1; l++)
+    {
+        if (l > level && blend == 0.0f) break;
+
+        const unsigned char* pixels = l == 0 ? texture.pixels.data() : texture.mips[l - 1].pixels.data();
+        int width = l == 0 ? texture.width : texture.mips[l - 1].width;
+        int height = l == 0 ? texture.height : texture.mips[l - 1].height;
+
+        sample_linear(pixels, width, height, u * width / texture.width, v * height / texture.height,
+            l == level ? colour : next);
+    }
+
+    for (int c = 0; c < 4; c++)
+    {
+        float value = blend > 0.0f ? colour[c] + (next[c] - colour[c]) * blend : colour[c];
+        texel[c] = (unsigned char)(value + 0.5f);
+    }
+}
@@ -0,0 +1,141 @@
+#pragma once
+
+#ifdef _WINDOWS
+    #include <GL/glew.h>
+#endif
+#define GL_GLEXT_PROTOTYPES 1
+#include <SDL_opengl.h>
+#include <atomic>
+#include <condition_variable>
+#include <map>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "glm/mat4x4.hpp"
+#include "SpriteBatch.h"
+
+// Draws the sprite pipeline on the CPU: the same textured, tinted quads the
+// instanced shader draws, sampled with each texture's filters as GL would
+// (nearest when magnified; bilinear, or trilinear between mip levels, when
+// minified) and blended with GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA, plus the
+// distance-field text. It lets frames be rendered where there is no GPU at
+// all, and gives golden images that do not depend on a driver.
+//
+// Quads are binned into TILE_SIZE squares as they are drawn; end_frame hands
+// the tiles out to a pool of worker threads, and each tile walks its quads
+// in order one horizontal span at a time. Spans are blended four pixels at a
+// time with SSE2 where the compiler has it, and by the same integer maths in
+// scalar code where it does not, so both give identical pixels.
+//
+// Like StaticLayer, the static sprites of a frame are kept as a picture and
+// only redrawn when their key changes.
+class SoftwareRasteriser
+{
+private:
+    static const int TILE_SIZE = 64;
+
+    struct Level
+    {
+        int width = 0, height = 0;
+        std::vector<unsigned char> pixels; // RGBA, top row first
+    };
+
+    struct Texture
+    {
+        int width = 0, height = 0;
+        std::vector<unsigned char> pixels; // level 0, RGBA, top row first
+        std::vector<Level> mips;           // levels 1 and up
+        GLenum min_filter = GL_NEAREST;
+        GLenum mag_filter = GL_NEAREST;
+    };
+
+    enum QuadKind { QUAD_SPRITE, QUAD_SDF_TEXT };
+
+    // A sprite mapped into screen space. The pixel centre (x, y) lies at
+    // s = s[0] + s[1] * x + s[2] * y on the quad, likewise t, and the quad
+    // covers -0.5 <= s, t < 0.5.
+    struct Quad
+    {
+        const Texture* texture;
+        QuadKind kind;
+        float s[3], t[3];
+        float uv_rect[4];
+        float lod;                    // log2 of level 0 texels per pixel; above 0 is minified
+        float tint[4];
+        unsigned short tint_bytes[4]; // tint in 0..255, for the integer blend
+        int min_x, min_y, max_x, max_y; // screen bounds, max exclusive
+    };
+
+    int m_width = 0;
+    int m_height = 0;
+    int m_tiles_across = 0;
+    int m_tiles_down = 0;
+    unsigned int m_clear_pixel = 0;
+    glm::mat4 m_matrix = glm::mat4(1.0f);
+
+    std::map<GLuint, Texture> m_textures;
+    std::vector<Quad> m_quads;
+    std::vector<std::vector<int> > m_bins; // quads touching each tile, in draw order
+    std::vector<unsigned char> m_pixels;   // RGBA, top row first
+
+    // ––––– STATIC LAYER ––––– //
+    std::vector<unsigned char> m_static_pixels;
+    unsigned long long m_static_key = 0;
+    bool m_static_valid = false;
+    bool m_static_cached = false; // this frame starts from the cached layer
+    int m_static_end = 0;         // quads before this index are static
+
+    // ––––– WORKERS ––––– //
+    std::vector<std::thread> m_workers;
+    std::mutex m_mutex;
+    std::condition_variable m_work_ready, m_work_done;
+    int m_generation = 0;   // bumped once per frame to wake the workers
+    int m_workers_busy = 0;
+    bool m_stopping = false;
+    std::atomic<int> m_next_tile;
+
+    void add_quad(GLuint texture_id, const SpriteInstance &instance, QuadKind kind);
+    void worker_main();
+    void rasterise_tiles();
+    void rasterise_tile(int tile);
+    void rasterise_quad(const Quad &quad, int tile_x0, int tile_y0, int tile_x1, int tile_y1);
+    static void sample_filtered(const Texture &texture, GLenum filter, float lod, float u, float v,
+                                unsigned char* texel);
+
+public:
+    SoftwareRasteriser() : m_next_tile(0) {}
+
+    void initialise(int width, int height);
+    void cleanup();
+
+    // Textures are looked up by the GL name the snapshot carries, so the CPU
+    // copy of a texture is registered under the id of its GPU twin. Sprites
+    // drawn with UNTEXTURED come out in their tint alone.
+    static const GLuint UNTEXTURED = 0;
+    void add_texture(GLuint texture_id, int width, int height, const unsigned char* rgba);
+    void add_luminance_alpha_texture(GLuint texture_id, int width, int height, const unsigned char* texels);
+    // Overwrites a rectangle of a texture, as glTexSubImage2D would
+    void update_texture(GLuint texture_id, int x, int y, int width, int height, const unsigned char* rgba);
+    // Level 1 and up of a texture already added, in order, as glTexImage2D would take them
+    void add_mip_level(GLuint texture_id, int width, int height, const unsigned char* rgba);
+    // Like GL_TEXTURE_MIN_FILTER and GL_TEXTURE_MAG_FILTER; both start as GL_NEAREST.
+    // GL_LINEAR_MIPMAP_LINEAR only blends levels that were added.
+    void set_filters(GLuint texture_id, GLenum min_filter, GLenum mag_filter);
+
+    void set_clear_colour(float red, float green, float blue, float alpha);
+    // Projection times view
+    void set_matrix(const glm::mat4 &matrix) { m_matrix = matrix; };
+
+    // Starts a frame whose static sprites are identified by `static_key`.
+    // Returns true if they are cached, and so need not be drawn at all.
+    bool begin_frame(unsigned long long static_key);
+    // Everything drawn before this is the frame's static layer
+    void end_static();
+    void draw_sprite(GLuint texture_id, const SpriteInstance &instance);
+    void draw_text(GLuint texture_id, const SpriteInstance &glyph);
+    void end_frame();
+
+    // RGBA, top row first, valid until the next begin_frame
+    const unsigned char* get_pixels() const { return m_pixels.data(); };
+    int const get_worker_count() const { return (int)m_workers.size(); };
+};
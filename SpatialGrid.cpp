@@ -0,0 +1,70 @@
+#include <algorithm>
+#include <cmath>
+#include "SpatialGrid.h"
+
+void SpatialGrid::initialise(const glm::vec2 &min, const glm::vec2 &max, float cell_size)
+{
+    m_origin = min;
+    m_cell_size = cell_size;
+    m_columns = std::max((int)ceilf((max.x - min.x) / cell_size), 1);
+    m_rows = std::max((int)ceilf((max.y - min.y) / cell_size), 1);
+
+    m_cells.assign((size_t)m_columns * m_rows, std::vector<int>());
+    m_query_stamps.clear();
+    m_query_stamp = 0;
+}
+
+void SpatialGrid::clear()
+{
+    for (int i = 0; i < (int)m_cells.size(); i++) m_cells[i].clear();
+    m_query_stamps.clear();
+}
+
+void SpatialGrid::cell_range(const glm::vec2 &min, const glm::vec2 &max, int* x0, int* y0, int* x1, int* y1) const
+{
+    *x0 = std::min(std::max((int)floorf((min.x - m_origin.x) / m_cell_size), 0), m_columns - 1);
+    *y0 = std::min(std::max((int)floorf((min.y - m_origin.y) / m_cell_size), 0), m_rows - 1);
+    *x1 = std::min(std::max((int)floorf((max.x - m_origin.x) / m_cell_size), 0), m_columns - 1);
+    *y1 = std::min(std::max((int)floorf((max.y - m_origin.y) / m_cell_size), 0), m_rows - 1);
+}
+
+void SpatialGrid::insert(int item, const glm::vec2 &min, const glm::vec2 &max)
+{
+    int x0, y0, x1, y1;
+    cell_range(min, max, &x0, &y0, &x1, &y1);
+
+    for (int y = y0; y <= y1; y++)
+    {
+        for (int x = x0; x <= x1; x++) m_cells[(size_t)y * m_columns + x].push_back(item);
+    }
+
+    if (item >= (int)m_query_stamps.size()) m_query_stamps.resize(item + 1, 0);
+}
+
+void SpatialGrid::query(const glm::vec2 &min, const glm::vec2 &max, std::vector<int> &items)
+{
+    int x0, y0, x1, y1;
+    cell_range(min, max, &x0, &y0, &x1, &y1);
+
+    // An item spanning several cells is only reported the first time
+    m_query_stamp++;
+    size_t first = items.size();
+
+    for (int y = y0; y <= y1; y++)
+    {
+        for (int x = x0; x <= x1; x++)
+        {
+            const std::vector<int> &cell = m_cells[(size_t)y * m_columns + x];
+
+            for (int i = 0; i < (int)cell.size(); i++)
+            {
+                if (m_query_stamps[cell[i]] == m_query_stamp) continue;
+
+                m_query_stamps[cell[i]] = m_query_stamp;
+                items.push_back(cell[i]);
+            }
+        }
+    }
+
+    std::sort(items.begin() + first, items.end());
+}
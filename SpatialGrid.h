@@ -0,0 +1,39 @@
+#pragma once
+
+#include <vector>
+#include "glm/vec2.hpp"
+
+// Buckets items by the square cells their bounds overlap, so finding what
+// might touch a rectangle costs time in proportion to the cells it covers
+// rather than to everything in the level. Items are plain indices into
+// whatever the caller keeps them in.
+//
+// Bounds outside the grid are clamped onto its edge cells, so nothing is
+// ever lost, only found a little more often than it needs to be.
+class SpatialGrid
+{
+private:
+    glm::vec2 m_origin = glm::vec2(0.0f);
+    float m_cell_size = 1.0f;
+    int m_columns = 0;
+    int m_rows = 0;
+
+    std::vector<std::vector<int> > m_cells;
+    std::vector<int> m_query_stamps; // per item, the last query that found it
+    int m_query_stamp = 0;
+
+    void cell_range(const glm::vec2 &min, const glm::vec2 &max, int* x0, int* y0, int* x1, int* y1) const;
+
+public:
+    void initialise(const glm::vec2 &min, const glm::vec2 &max, float cell_size);
+    void clear();
+
+    void insert(int item, const glm::vec2 &min, const glm::vec2 &max);
+
+    // Appends every item whose cells overlap the rectangle, each once and in
+    // ascending order, so callers that insert in draw order get draw order
+    // back. Items are candidates only; their bounds may still miss.
+    void query(const glm::vec2 &min, const glm::vec2 &max, std::vector<int> &items);
+
+    int const get_cell_count() const { return m_columns * m_rows; };
+};
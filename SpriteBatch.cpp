@@ -0,0 +1,362 @@
+#define GL_SILENCE_DEPRECATION
+
+#include <algorithm>
+#include <iostream>
+#include "GLState.h"
+#include "SpriteBatch.h"
+
+// Corners of the unit quad in triangle-strip order
+const float UNIT_QUAD[] = { -0.5f, -0.5f,  0.5f, -0.5f,  -0.5f, 0.5f,  0.5f, 0.5f };
+
+void SpriteBatch::initialise()
+{
+    size_t vertex_batch_size   = MAX_SPRITES * VERTICES_PER_SPRITE * FLOATS_PER_VERTEX * sizeof(float);
+    size_t instance_batch_size = MAX_INSTANCES * FLOATS_PER_INSTANCE * sizeof(float);
+
+    m_vertex_buffer.initialise(GL_ARRAY_BUFFER,
+        BATCHES_IN_FLIGHT * (instance_batch_size > vertex_batch_size ? instance_batch_size : vertex_batch_size));
+    m_index_buffer = create_quad_index_buffer(MAX_SPRITES);
+    m_unit_quad_buffer = create_static_buffer(GL_ARRAY_BUFFER, sizeof(UNIT_QUAD), UNIT_QUAD);
+}
+
+void SpriteBatch::cleanup()
+{
+    for (std::map<GLuint, GLuint>::iterator it = m_vertex_arrays.begin(); it != m_vertex_arrays.end(); ++it)
+    {
+        gl_delete_vertex_array(it->second);
+    }
+    m_vertex_arrays.clear();
+
+    m_vertex_buffer.cleanup();
+    gl_delete_buffer(m_index_buffer);
+    gl_delete_buffer(m_unit_quad_buffer);
+    m_index_buffer = 0;
+    m_unit_quad_buffer = 0;
+}
+
+GLuint SpriteBatch::get_vertex_array(ShaderProgram* program)
+{
+    std::map<GLuint, GLuint>::iterator found = m_vertex_arrays.find(program->get_program_id());
+    if (found != m_vertex_arrays.end()) return found->second;
+
+    // The attribute layout is recorded once; afterwards a draw only needs the
+    // VAO bound and an offset into the ring buffer.
+    GLuint vertex_array = program->is_instanced() ? create_instanced_vertex_array(program)
+                                                  : create_vertex_array(program);
+
+    m_vertex_arrays[program->get_program_id()] = vertex_array;
+    return vertex_array;
+}
+
+GLuint SpriteBatch::create_vertex_array(ShaderProgram* program)
+{
+    GLuint vertex_array;
+    GLsizei stride = FLOATS_PER_VERTEX * sizeof(float);
+
+    glGenVertexArrays(1, &vertex_array);
+    gl_bind_vertex_array(vertex_array);
+    gl_bind_buffer(GL_ARRAY_BUFFER, m_vertex_buffer.get_buffer_id());
+    gl_bind_buffer(GL_ELEMENT_ARRAY_BUFFER, m_index_buffer);
+
+    glVertexAttribPointer(program->get_position_attribute(), 2, GL_FLOAT, false, stride, (void*)0);
+    gl_enable_vertex_attrib_array(program->get_position_attribute());
+
+    // Variants without a texture or tint compile those attributes out
+    if (program->get_tex_coordinate_attribute() != (GLuint)-1)
+    {
+        glVertexAttribPointer(program->get_tex_coordinate_attribute(), 2, GL_FLOAT, false, stride,
+            (void*)(2 * sizeof(float)));
+        gl_enable_vertex_attrib_array(program->get_tex_coordinate_attribute());
+    }
+
+    if (program->get_tint_attribute() != (GLuint)-1)
+    {
+        glVertexAttribPointer(program->get_tint_attribute(), 4, GL_FLOAT, false, stride,
+            (void*)(4 * sizeof(float)));
+        gl_enable_vertex_attrib_array(program->get_tint_attribute());
+    }
+
+
+    return vertex_array;
+}
+
+GLuint SpriteBatch::create_instanced_vertex_array(ShaderProgram* program)
+{
+    GLuint vertex_array;
+
+    glGenVertexArrays(1, &vertex_array);
+    gl_bind_vertex_array(vertex_array);
+
+    // The unit quad advances per vertex...
+    gl_bind_buffer(GL_ARRAY_BUFFER, m_unit_quad_buffer);
+    glVertexAttribPointer(program->get_position_attribute(), 2, GL_FLOAT, false, 0, (void*)0);
+    gl_enable_vertex_attrib_array(program->get_position_attribute());
+
+    // ...everything else once per sprite
+    gl_enable_vertex_attrib_array(program->get_sprite_position_attribute());
+    gl_enable_vertex_attrib_array(program->get_sprite_basis_attribute());
+    glVertexAttribDivisor(program->get_sprite_position_attribute(), 1);
+    glVertexAttribDivisor(program->get_sprite_basis_attribute(), 1);
+
+    // Variants without a texture or tint compile those attributes out
+    if (program->get_sprite_uv_attribute() != (GLuint)-1)
+    {
+        gl_enable_vertex_attrib_array(program->get_sprite_uv_attribute());
+        glVertexAttribDivisor(program->get_sprite_uv_attribute(), 1);
+    }
+
+    if (program->get_tint_attribute() != (GLuint)-1)
+    {
+        gl_enable_vertex_attrib_array(program->get_tint_attribute());
+        glVertexAttribDivisor(program->get_tint_attribute(), 1);
+    }
+
+
+    return vertex_array;
+}
+
+void SpriteBatch::point_instance_attributes(GLuint buffer_id, size_t offset)
+{
+    // Base instances need GL 4.2, so the per-instance pointers are moved to
+    // this batch's slice of the ring instead. That is four calls per batch,
+    // not per sprite.
+    GLsizei stride = FLOATS_PER_INSTANCE * sizeof(float);
+
+    gl_bind_buffer(GL_ARRAY_BUFFER, buffer_id);
+    glVertexAttribPointer(m_program->get_sprite_position_attribute(), 2, GL_FLOAT, false, stride,
+        (void*)offset);
+    glVertexAttribPointer(m_program->get_sprite_basis_attribute(), 4, GL_FLOAT, false, stride,
+        (void*)(offset + 2 * sizeof(float)));
+
+    if (m_program->get_sprite_uv_attribute() != (GLuint)-1)
+    {
+        glVertexAttribPointer(m_program->get_sprite_uv_attribute(), 4, GL_FLOAT, false, stride,
+            (void*)(offset + 6 * sizeof(float)));
+    }
+
+    if (m_program->get_tint_attribute() != (GLuint)-1)
+    {
+        glVertexAttribPointer(m_program->get_tint_attribute(), 4, GL_FLOAT, false, stride,
+            (void*)(offset + 10 * sizeof(float)));
+    }
+}
+
+void SpriteBatch::begin(ShaderProgram* program)
+{
+    if (m_program != program) flush();
+
+    m_program = program;
+    m_instanced = program->is_instanced();
+    gl_use_program(program->get_program_id());
+
+    // Vertices arrive already transformed, so the model matrix stays identity
+    m_program->set_model_matrix(glm::mat4(1.0f));
+}
+
+void SpriteBatch::end()
+{
+    flush();
+}
+
+SpriteInstance make_sprite_instance(const glm::mat4 &model_matrix, const glm::vec4 &uv_rect,
+                                    const glm::vec4 &tint)
+{
+    SpriteInstance instance;
+
+    instance.position[0] = model_matrix[3][0];
+    instance.position[1] = model_matrix[3][1];
+    instance.basis[0]    = model_matrix[0][0];
+    instance.basis[1]    = model_matrix[0][1];
+    instance.basis[2]    = model_matrix[1][0];
+    instance.basis[3]    = model_matrix[1][1];
+    instance.uv_rect[0]  = uv_rect.x;
+    instance.uv_rect[1]  = uv_rect.y;
+    instance.uv_rect[2]  = uv_rect.z;
+    instance.uv_rect[3]  = uv_rect.w;
+    instance.tint[0]     = tint.r;
+    instance.tint[1]     = tint.g;
+    instance.tint[2]     = tint.b;
+    instance.tint[3]     = tint.a;
+
+    return instance;
+}
+
+float* SpriteBatch::push_vertex(float* write_pointer, float x, float y, float u, float v, const float* tint)
+{
+    write_pointer[0] = x;
+    write_pointer[1] = y;
+    write_pointer[2] = u;
+    write_pointer[3] = v;
+    write_pointer[4] = tint[0];
+    write_pointer[5] = tint[1];
+    write_pointer[6] = tint[2];
+    write_pointer[7] = tint[3];
+
+    return write_pointer + FLOATS_PER_VERTEX;
+}
+
+void SpriteBatch::draw_quad(GLuint texture_id, const glm::mat4 &model_matrix, const glm::vec4 &uv_rect,
+                            const glm::vec4 &tint)
+{
+    draw_instance(texture_id, make_sprite_instance(model_matrix, uv_rect, tint));
+}
+
+void SpriteBatch::draw_instance(GLuint texture_id, const SpriteInstance &instance)
+{
+    if (texture_id != m_texture_id || m_sprite_count == get_capacity()) flush();
+    m_texture_id = texture_id;
+
+    if (m_write_pointer == NULL)
+    {
+        m_write_pointer = (float*)m_vertex_buffer.reserve(get_capacity() * get_sprite_size(), get_sprite_size());
+    }
+
+    write_sprite(m_write_pointer, 0, instance);
+
+    m_write_pointer += get_sprite_size() / sizeof(float);
+    m_sprite_count++;
+    m_frame_stats.sprites++;
+}
+
+void SpriteBatch::write_sprite(void* slots, int slot, const SpriteInstance &instance) const
+{
+    float* write_pointer = (float*)((unsigned char*)slots + slot * get_sprite_size());
+
+    if (m_instanced)
+    {
+        *(SpriteInstance*)write_pointer = instance;
+        return;
+    }
+
+    // Half of each axis, so the corners are centre +/- x_axis +/- y_axis
+    const float* centre = instance.position;
+    float x_axis[2] = { 0.5f * instance.basis[0], 0.5f * instance.basis[1] };
+    float y_axis[2] = { 0.5f * instance.basis[2], 0.5f * instance.basis[3] };
+    const float* uv_rect = instance.uv_rect;
+
+    // uv_rect is (u0, v0, u1, v1) with v0 at the top edge of the sprite
+    write_pointer = push_vertex(write_pointer, centre[0] - x_axis[0] - y_axis[0], centre[1] - x_axis[1] - y_axis[1], uv_rect[0], uv_rect[3], instance.tint);
+    write_pointer = push_vertex(write_pointer, centre[0] + x_axis[0] - y_axis[0], centre[1] + x_axis[1] - y_axis[1], uv_rect[2], uv_rect[3], instance.tint);
+    write_pointer = push_vertex(write_pointer, centre[0] + x_axis[0] + y_axis[0], centre[1] + x_axis[1] + y_axis[1], uv_rect[2], uv_rect[1], instance.tint);
+    push_vertex(write_pointer, centre[0] - x_axis[0] + y_axis[0], centre[1] - x_axis[1] + y_axis[1], uv_rect[0], uv_rect[1], instance.tint);
+}
+
+void* SpriteBatch::reserve_sprites(int count)
+{
+    // Whatever is queued was submitted first, so it has to be drawn first
+    flush();
+
+    // Writing one reservation must not wait on the GPU reading the one before
+    size_t size = count * get_sprite_size();
+    if (size * RESERVATIONS_IN_FLIGHT > m_vertex_buffer.get_capacity()) grow_vertex_buffer(size * RESERVATIONS_IN_FLIGHT);
+
+    m_reserved_count = count;
+    m_reserved_drawn = 0;
+    return m_vertex_buffer.reserve(size, get_sprite_size());
+}
+
+void SpriteBatch::grow_vertex_buffer(size_t capacity)
+{
+    // Draws already issued keep the old storage alive until they are done
+    m_vertex_buffer.cleanup();
+    m_vertex_buffer.initialise(GL_ARRAY_BUFFER, capacity);
+
+    // The per-vertex layouts point at the old buffer; they are made again as needed
+    for (std::map<GLuint, GLuint>::iterator it = m_vertex_arrays.begin(); it != m_vertex_arrays.end(); ++it)
+    {
+        gl_delete_vertex_array(it->second);
+    }
+    m_vertex_arrays.clear();
+
+    std::cout << "Sprite batch: ring buffer grown to " << capacity / 1024 << " KB" << std::endl;
+}
+
+void SpriteBatch::draw_reserved(GLuint texture_id, int count)
+{
+    // The first run finds every slot written, so the whole reservation is
+    // committed at once
+    if (m_reserved_count > 0)
+    {
+        m_reserved_offset = m_vertex_buffer.commit(m_reserved_count * get_sprite_size());
+        m_reserved_count = 0;
+    }
+
+    // The index buffer only covers one batch of quads
+    for (int drawn = 0; drawn < count; drawn += get_capacity())
+    {
+        draw_range(texture_id, m_reserved_offset + (m_reserved_drawn + drawn) * get_sprite_size(),
+            std::min(count - drawn, get_capacity()));
+    }
+    m_reserved_drawn += count;
+    m_frame_stats.sprites += count;
+}
+
+void SpriteBatch::draw_rect(GLuint texture_id, const glm::vec2 &centre, const glm::vec2 &size,
+                            const glm::vec4 &uv_rect, const glm::vec4 &tint)
+{
+    glm::mat4 model_matrix = glm::mat4(1.0f);
+    model_matrix[0][0] = size.x;
+    model_matrix[1][1] = size.y;
+    model_matrix[3][0] = centre.x;
+    model_matrix[3][1] = centre.y;
+
+    draw_quad(texture_id, model_matrix, uv_rect, tint);
+}
+
+void SpriteBatch::flush()
+{
+    if (m_write_pointer == NULL) return;
+
+    size_t offset = m_vertex_buffer.commit(m_sprite_count * get_sprite_size());
+    draw_range(m_texture_id, offset, m_sprite_count);
+
+    m_write_pointer = NULL;
+    m_sprite_count = 0;
+}
+
+void SpriteBatch::draw_range(GLuint texture_id, size_t offset, int count)
+{
+    if (count <= 0 || m_program == NULL) return;
+
+    gl_bind_vertex_array(get_vertex_array(m_program));
+    gl_bind_texture(texture_id);
+
+    if (m_instanced)
+    {
+        point_instance_attributes(m_vertex_buffer.get_buffer_id(), offset);
+        glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, count);
+    }
+    else
+    {
+        GLint base_vertex = (GLint)(offset / (FLOATS_PER_VERTEX * sizeof(float)));
+        glDrawElementsBaseVertex(GL_TRIANGLES, count * 6, GL_UNSIGNED_SHORT, (void*)0, base_vertex);
+    }
+
+    m_frame_stats.draw_calls++;
+    m_frame_stats.vertices += count * VERTICES_PER_SPRITE;
+}
+
+void SpriteBatch::draw_instances(GLuint texture_id, GLuint instance_buffer_id, int count)
+{
+    // Whatever is queued was submitted first, so it has to be drawn first
+    flush();
+
+    if (count <= 0 || m_program == NULL || !m_instanced) return;
+
+    gl_bind_vertex_array(get_vertex_array(m_program));
+    gl_bind_texture(texture_id);
+    point_instance_attributes(instance_buffer_id, 0);
+    glDrawArraysInstanced(GL_TRIANGLE_STRIP, 0, 4, count);
+
+    m_frame_stats.draw_calls++;
+    m_frame_stats.vertices += count * VERTICES_PER_SPRITE;
+    m_frame_stats.sprites += count;
+}
+
+void SpriteBatch::end_frame()
+{
+    flush();
+
+    m_last_frame_stats = m_frame_stats;
+    m_frame_stats = SpriteBatchStats();
+}
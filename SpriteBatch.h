@@ -0,0 +1,128 @@
+#pragma once
+
+#ifdef _WINDOWS
+    #include <GL/glew.h>
+#endif
+#define GL_GLEXT_PROTOTYPES 1
+#include <SDL_opengl.h>
+#include <map>
+#include "glm/mat4x4.hpp"
+#include "ShaderProgram.h"
+#include "GpuBuffer.h"
+
+struct SpriteBatchStats
+{
+    int draw_calls = 0;
+    int vertices = 0;
+    int sprites = 0;
+};
+
+// One sprite as the instanced shader reads it: centre, the two columns of its
+// 2x2 transform, uv rect (v0 at the top) and tint
+struct SpriteInstance
+{
+    float position[2];
+    float basis[4];
+    float uv_rect[4];
+    float tint[4];
+};
+
+// Only the 2D part of the model matrix is kept
+SpriteInstance make_sprite_instance(const glm::mat4 &model_matrix, const glm::vec4 &uv_rect,
+                                    const glm::vec4 &tint);
+
+// Collects textured quads and draws them in as few calls as possible. Quads are
+// written straight into a GPU ring buffer; the batch is only flushed when the
+// texture or shader changes, or when it is full.
+//
+// With an instanced shader (INSTANCED in sprite_vertex.glsl) each sprite is a
+// single 56-byte instance expanded on the GPU from a shared unit quad.
+// Otherwise the quad is transformed on the CPU into 4 vertices.
+class SpriteBatch
+{
+private:
+    // x, y, u, v, r, g, b, a
+    static const int FLOATS_PER_VERTEX = 8;
+    static const int VERTICES_PER_SPRITE = 4;
+    static const int MAX_SPRITES = 4096;
+
+    // position (2), basis (4), uv rect (4), tint (4)
+    static const int FLOATS_PER_INSTANCE = sizeof(SpriteInstance) / sizeof(float);
+    static const int MAX_INSTANCES = 16384;
+
+    static const int BATCHES_IN_FLIGHT = 4;
+    static const int RESERVATIONS_IN_FLIGHT = 2; // a frame's worth each, so fewer are needed
+
+    ShaderProgram* m_program = NULL;
+    GLuint m_texture_id = 0;
+    bool m_instanced = false;
+
+    // ––––– GPU-RESIDENT GEOMETRY ––––– //
+    StreamBuffer m_vertex_buffer;
+    GLuint m_index_buffer = 0;
+    GLuint m_unit_quad_buffer = 0;
+    std::map<GLuint, GLuint> m_vertex_arrays; // one VAO per shader program layout
+
+    float* m_write_pointer = NULL;
+    int m_sprite_count = 0;
+
+    // ––––– RESERVED SPRITES ––––– //
+    int m_reserved_count = 0;    // written by the caller, not yet committed
+    size_t m_reserved_offset = 0;
+    int m_reserved_drawn = 0;
+
+    SpriteBatchStats m_frame_stats;
+    SpriteBatchStats m_last_frame_stats;
+
+    GLuint get_vertex_array(ShaderProgram* program);
+    GLuint create_vertex_array(ShaderProgram* program);
+    GLuint create_instanced_vertex_array(ShaderProgram* program);
+    void   point_instance_attributes(GLuint buffer_id, size_t offset);
+    void   draw_range(GLuint texture_id, size_t offset, int count);
+    void   grow_vertex_buffer(size_t capacity);
+
+    // Writes one CPU-expanded vertex and returns where the next one goes
+    static float* push_vertex(float* write_pointer, float x, float y, float u, float v, const float* tint);
+
+    size_t const get_sprite_size() const
+    {
+        return m_instanced ? FLOATS_PER_INSTANCE * sizeof(float)
+                           : VERTICES_PER_SPRITE * FLOATS_PER_VERTEX * sizeof(float);
+    };
+
+public:
+    void initialise();
+    void cleanup();
+
+    void begin(ShaderProgram* program);
+    void end();
+    void flush();
+
+    void draw_quad(GLuint texture_id, const glm::mat4 &model_matrix, const glm::vec4 &uv_rect,
+                   const glm::vec4 &tint);
+    void draw_rect(GLuint texture_id, const glm::vec2 &centre, const glm::vec2 &size,
+                   const glm::vec4 &uv_rect, const glm::vec4 &tint);
+    void draw_instance(GLuint texture_id, const SpriteInstance &instance);
+
+    // Draws instances that already live in a buffer owned by the caller (see
+    // TextMesh). Only valid with an instanced shader.
+    void draw_instances(GLuint texture_id, GLuint instance_buffer_id, int count);
+
+    // For sprites generated outside the batch, possibly on other threads:
+    // reserve room for any number of them, fill slot i with
+    // write_sprite(slots, i, ...), then draw them in slot order with one
+    // draw_reserved per run that shares a texture. Only write_sprite may be
+    // called from other threads. A reservation bigger than the ring was made
+    // for grows it, so a whole frame's sprites can be generated in one go.
+    void* reserve_sprites(int count);
+    void  write_sprite(void* slots, int slot, const SpriteInstance &instance) const;
+    void  draw_reserved(GLuint texture_id, int count);
+
+    // Call once per frame; the counters of the frame just finished stay readable
+    void end_frame();
+
+    const SpriteBatchStats &get_stats()    const { return m_last_frame_stats; };
+    bool   const            is_instanced() const { return m_instanced;        };
+    // Most sprites a single draw holds
+    int    const            get_capacity() const { return m_instanced ? MAX_INSTANCES : MAX_SPRITES; };
+};
@@ -0,0 +1,118 @@
+#define GL_SILENCE_DEPRECATION
+
+#include <iostream>
+#include "GLState.h"
+#include "StaticLayer.h"
+
+void StaticLayer::initialise()
+{
+    // Framebuffer objects are core in every context we run on; only an
+    // incomplete one turns the layer off
+    m_supported = true;
+
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    set_size(viewport[2], viewport[3]);
+}
+
+void StaticLayer::cleanup()
+{
+    for (int i = 0; i < MAX_LAYERS; i++) release(m_layers[i]);
+}
+
+void StaticLayer::release(CachedLayer &layer)
+{
+    if (layer.framebuffer != 0) glDeleteFramebuffers(1, &layer.framebuffer);
+    gl_delete_texture(layer.texture_id);
+
+    layer = CachedLayer();
+}
+
+void StaticLayer::set_size(int width, int height)
+{
+    if (width == m_width && height == m_height) return;
+
+    cleanup();
+    m_width = width;
+    m_height = height;
+}
+
+int const StaticLayer::find(unsigned long long key) const
+{
+    for (int i = 0; i < MAX_LAYERS; i++)
+    {
+        if (m_layers[i].last_used >= 0 && m_layers[i].key == key) return i;
+    }
+
+    return -1;
+}
+
+bool StaticLayer::begin_capture(unsigned long long key)
+{
+    // STEP 1: Reuse the least recently composited slot; empty ones go first
+    int slot = 0;
+    for (int i = 1; i < MAX_LAYERS; i++)
+    {
+        if (m_layers[i].last_used < m_layers[slot].last_used) slot = i;
+    }
+
+    CachedLayer &layer = m_layers[slot];
+    glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &m_target_framebuffer);
+
+    // STEP 2: Storage is only created once per slot and size
+    if (layer.framebuffer == 0)
+    {
+        glGenTextures(1, &layer.texture_id);
+        gl_bind_texture(layer.texture_id);
+        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA8, m_width, m_height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+
+        glGenFramebuffers(1, &layer.framebuffer);
+        glBindFramebuffer(GL_FRAMEBUFFER, layer.framebuffer);
+        glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, layer.texture_id, 0);
+
+        if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE)
+        {
+            std::cout << "Static layer: framebuffer incomplete, falling back to redrawing" << std::endl;
+            glBindFramebuffer(GL_FRAMEBUFFER, m_target_framebuffer);
+            cleanup();
+            m_supported = false;
+            return false;
+        }
+    }
+    else
+    {
+        glBindFramebuffer(GL_FRAMEBUFFER, layer.framebuffer);
+    }
+
+    layer.key = key;
+    layer.last_used = m_use_counter++;
+    m_capturing = slot;
+
+    glClear(GL_COLOR_BUFFER_BIT);
+    return true;
+}
+
+void StaticLayer::end_capture()
+{
+    if (m_capturing < 0) return;
+
+    glBindFramebuffer(GL_FRAMEBUFFER, m_target_framebuffer);
+    m_capturing = -1;
+}
+
+void StaticLayer::composite(unsigned long long key)
+{
+    int slot = find(key);
+    if (slot < 0) return;
+
+    m_layers[slot].last_used = m_use_counter++;
+
+    GLint previous_read_framebuffer = 0;
+    glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &previous_read_framebuffer);
+
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, m_layers[slot].framebuffer);
+    glBlitFramebuffer(0, 0, m_width, m_height, 0, 0, m_width, m_height, GL_COLOR_BUFFER_BIT, GL_NEAREST);
+    glBindFramebuffer(GL_READ_FRAMEBUFFER, previous_read_framebuffer);
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#ifdef _WINDOWS
+    #include <GL/glew.h>
+#endif
+#define GL_GLEXT_PROTOTYPES 1
+#include <SDL_opengl.h>
+
+// Full-screen pictures of the parts of a scene that never move, kept in
+// offscreen framebuffers. A layer is drawn once, the first time its key is
+// seen, and after that every frame starts with one opaque blit of it instead
+// of redrawing and blending every sprite in it.
+//
+// Keys identify the content (see RenderSnapshot::static_hash), so a new level
+// simply misses the cache. A few layers are kept because static content can
+// alternate between states, like our blinking danger signs. A change of
+// viewport size drops them all.
+class StaticLayer
+{
+private:
+    static const int MAX_LAYERS = 2;
+
+    struct CachedLayer
+    {
+        unsigned long long key = 0;
+        GLuint framebuffer = 0;
+        GLuint texture_id = 0;
+        int last_used = -1; // -1 while the slot holds nothing
+    };
+
+    CachedLayer m_layers[MAX_LAYERS];
+    int m_width = 0;
+    int m_height = 0;
+    int m_use_counter = 0;
+    int m_capturing = -1; // slot being drawn into, if any
+    GLint m_target_framebuffer = 0; // what was bound before the capture; not always the window
+    bool m_supported = false;
+
+    int  const find(unsigned long long key) const;
+    void release(CachedLayer &layer);
+
+public:
+    // Sizes the layers to the current viewport
+    void initialise();
+    void cleanup();
+
+    // Call whenever the viewport may have changed; drops every layer if it did
+    void set_size(int width, int height);
+
+    bool const contains(unsigned long long key) const { return find(key) >= 0; };
+
+    // Redirects drawing into a fresh layer for `key`, cleared to the clear
+    // colour. Returns false, and stops being supported, if the driver refuses
+    // the framebuffer.
+    bool begin_capture(unsigned long long key);
+    void end_capture();
+
+    // Overwrites the whole framebuffer with the layer; no blending, no clear needed
+    void composite(unsigned long long key);
+
+    bool const is_supported() const { return m_supported; };
+};
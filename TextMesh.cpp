@@ -0,0 +1,146 @@
+#define GL_SILENCE_DEPRECATION
+
+#include "GLExtensions.h"
+#include "GLState.h"
+#include "TextMesh.h"
+
+void TextMesh::initialise(GLuint texture_id, const AtlasRegion &font_region, int fontbank_size,
+                          float font_size, float spacing, const glm::vec3 &position)
+{
+    m_texture_id = texture_id;
+    m_font_region = font_region;
+    m_fontbank_size = fontbank_size;
+    m_font_size = font_size;
+    m_spacing = spacing;
+    m_position = position;
+
+    // Without a context the glyphs are only read back by the software rasteriser
+    if (gl_has_context()) glGenBuffers(1, &m_instance_buffer);
+}
+
+void TextMesh::cleanup()
+{
+    gl_delete_buffer(m_instance_buffer);
+    m_instance_buffer = 0;
+    m_capacity = 0;
+    m_glyphs.clear();
+    m_text.clear();
+}
+
+SpriteInstance const TextMesh::make_glyph(int index, char character) const
+{
+    // The glyph's offset is its position relative to the whole sentence, and
+    // its ascii value is its index in the font's sprite sheet
+    float offset = (m_font_size + m_spacing) * index;
+    glm::vec4 uv_rect = m_font_region.cell((unsigned char)character, m_fontbank_size, m_fontbank_size);
+
+    SpriteInstance glyph;
+    glyph.position[0] = m_position.x + offset;
+    glyph.position[1] = m_position.y;
+    glyph.basis[0]    = m_font_size;
+    glyph.basis[1]    = 0.0f;
+    glyph.basis[2]    = 0.0f;
+    glyph.basis[3]    = m_font_size;
+    glyph.uv_rect[0]  = uv_rect.x;
+    glyph.uv_rect[1]  = uv_rect.y;
+    glyph.uv_rect[2]  = uv_rect.z;
+    glyph.uv_rect[3]  = uv_rect.w;
+    glyph.tint[0]     = m_tint.r;
+    glyph.tint[1]     = m_tint.g;
+    glyph.tint[2]     = m_tint.b;
+    glyph.tint[3]     = m_tint.a;
+
+    return glyph;
+}
+
+void TextMesh::rebuild(const std::string &text, bool all_glyphs)
+{
+    int length = (int)text.size();
+    int old_length = (int)m_text.size();
+    bool upload = m_instance_buffer != 0;
+
+    if (upload) gl_bind_buffer(GL_ARRAY_BUFFER, m_instance_buffer);
+
+    // STEP 1: Grow the buffer geometrically; a fresh store has to be filled in full
+    if (length > m_capacity)
+    {
+        m_capacity = m_capacity * 2 > length ? m_capacity * 2 : length;
+        if (m_capacity < MINIMUM_CAPACITY) m_capacity = MINIMUM_CAPACITY;
+
+        if (upload) glBufferData(GL_ARRAY_BUFFER, m_capacity * sizeof(SpriteInstance), NULL, GL_DYNAMIC_DRAW);
+        all_glyphs = true;
+    }
+
+    // STEP 2: Rebuild only the glyphs whose character changed, remembering the
+    //         span they cover
+    m_glyphs.resize(length);
+
+    int first_changed = length;
+    int last_changed = -1;
+
+    for (int i = 0; i < length; i++)
+    {
+        if (!all_glyphs && i < old_length && text[i] == m_text[i]) continue;
+
+        m_glyphs[i] = make_glyph(i, text[i]);
+
+        if (i < first_changed) first_changed = i;
+        last_changed = i;
+    }
+
+    // STEP 3: Upload that span alone. A shorter string just draws fewer
+    //         instances, so trailing glyphs never need clearing.
+    if (upload && last_changed >= first_changed)
+    {
+        glBufferSubData(GL_ARRAY_BUFFER, first_changed * sizeof(SpriteInstance),
+            (last_changed - first_changed + 1) * sizeof(SpriteInstance), &m_glyphs[first_changed]);
+    }
+
+    m_text = text;
+}
+
+void TextMesh::set_text(const std::string &text)
+{
+    if (text == m_text) return;
+
+    rebuild(text, false);
+}
+
+void TextMesh::set_position(const glm::vec3 &position)
+{
+    if (position == m_position) return;
+
+    m_position = position;
+    rebuild(m_text, true);
+}
+
+void TextMesh::set_tint(const glm::vec4 &tint)
+{
+    if (tint == m_tint) return;
+
+    m_tint = tint;
+    rebuild(m_text, true);
+}
+
+void TextMesh::render(SpriteBatch* batch) const
+{
+    if (m_glyphs.empty()) return;
+
+    if (batch->is_instanced())
+    {
+        batch->draw_instances(m_texture_id, m_instance_buffer, (int)m_glyphs.size());
+        return;
+    }
+
+    // Without instancing the retained glyphs still save the per-frame string
+    // work; the batch only has to expand them into quads
+    for (int i = 0; i < (int)m_glyphs.size(); i++)
+    {
+        const SpriteInstance &glyph = m_glyphs[i];
+
+        batch->draw_rect(m_texture_id, glm::vec2(glyph.position[0], glyph.position[1]),
+            glm::vec2(glyph.basis[0], glyph.basis[3]),
+            glm::vec4(glyph.uv_rect[0], glyph.uv_rect[1], glyph.uv_rect[2], glyph.uv_rect[3]),
+            glm::vec4(glyph.tint[0], glyph.tint[1], glyph.tint[2], glyph.tint[3]));
+    }
+}
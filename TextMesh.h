@@ -0,0 +1,60 @@
+#pragma once
+
+#ifdef _WINDOWS
+    #include <GL/glew.h>
+#endif
+#define GL_GLEXT_PROTOTYPES 1
+#include <SDL_opengl.h>
+#include <string>
+#include <vector>
+#include "glm/vec3.hpp"
+#include "glm/vec4.hpp"
+#include "SpriteBatch.h"
+#include "TextureAtlas.h"
+
+// A string whose glyphs stay on the GPU between frames. Changing the text only
+// rebuilds and re-uploads the glyphs that actually differ, so static text costs
+// nothing on the CPU and a counter only touches the digits that rolled over.
+//
+// With an instanced shader the whole string is drawn straight from its own
+// buffer in one call; otherwise the retained glyphs are fed to the batch.
+class TextMesh
+{
+private:
+    static const int MINIMUM_CAPACITY = 16;
+
+    GLuint m_texture_id = 0;
+    AtlasRegion m_font_region;
+    int m_fontbank_size = 16;
+    float m_font_size = 0.0f;
+    float m_spacing = 0.0f;
+    glm::vec3 m_position = glm::vec3(0.0f);
+    glm::vec4 m_tint = glm::vec4(1.0f);
+
+    std::string m_text;
+    std::vector<SpriteInstance> m_glyphs; // what the GPU buffer currently holds
+
+    GLuint m_instance_buffer = 0;
+    int m_capacity = 0; // glyphs the GPU buffer has room for
+
+    SpriteInstance const make_glyph(int index, char character) const;
+    void rebuild(const std::string &text, bool all_glyphs);
+
+public:
+    void initialise(GLuint texture_id, const AtlasRegion &font_region, int fontbank_size,
+                    float font_size, float spacing, const glm::vec3 &position);
+    void cleanup();
+
+    void set_text(const std::string &text);
+    void set_position(const glm::vec3 &position);
+    void set_tint(const glm::vec4 &tint);
+
+    void render(SpriteBatch* batch) const;
+
+    const std::string &get_text()       const { return m_text;       };
+    glm::vec3   const  get_position()   const { return m_position;   };
+    GLuint      const  get_texture_id() const { return m_texture_id; };
+
+    // The glyphs as last built, for renderers that do not use our buffer
+    const std::vector<SpriteInstance> &get_glyphs() const { return m_glyphs; };
+};
@@ -0,0 +1,721 @@
+#define GL_SILENCE_DEPRECATION
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include "stb_image.h"
+#include "GLExtensions.h"
+#include "GLState.h"
+#include "ImageResize.h"
+#include "TextureCompression.h"
+#include "TextureAtlas.h"
+
+const unsigned int ATLAS_CACHE_MAGIC = 0x54414c4c; // "LLAT"
+const unsigned int ATLAS_CACHE_VERSION = 2;
+
+static int level_size(int size, int level)
+{
+    return std::max(size >> level, 1);
+}
+
+glm::vec4 const AtlasRegion::cell(int index, int cols, int rows) const
+{
+    float cell_width = (uv_rect.z - uv_rect.x) / (float)cols;
+    float cell_height = (uv_rect.w - uv_rect.y) / (float)rows;
+
+    float u = uv_rect.x + (float)(index % cols) * cell_width;
+    float v = uv_rect.y + (float)(index / cols) * cell_height;
+
+    return glm::vec4(u, v, u + cell_width, v + cell_height);
+}
+
+void TextureAtlas::add_image(const std::string &name, const char* filepath, const glm::ivec2 &max_size)
+{
+    Source source;
+    source.name = name;
+    source.filepath = filepath;
+    source.max_width = max_size.x;
+    source.max_height = max_size.y;
+
+    m_sources.push_back(source);
+}
+
+const AtlasRegion &TextureAtlas::get_region(const std::string &name) const
+{
+    static const AtlasRegion EMPTY_REGION;
+
+    std::map<std::string, AtlasRegion>::const_iterator found = m_regions.find(name);
+    if (found == m_regions.end())
+    {
+        std::cout << "No atlas region named " << name << std::endl;
+        return EMPTY_REGION;
+    }
+
+    return found->second;
+}
+
+// ––––– CACHE ––––– //
+unsigned long long TextureAtlas::hash_sources() const
+{
+    // FNV-1a over the layout settings and every byte of every source file
+    unsigned long long hash = 14695981039346656037ULL;
+    const unsigned long long PRIME = 1099511628211ULL;
+
+    std::ostringstream settings;
+    settings << ATLAS_CACHE_VERSION << ' ' << PADDING << ' ' << m_page_size << ' ' << MIP_LEVELS << ' ' << m_compress;
+
+    std::string header = settings.str();
+    for (int i = 0; i < (int)header.size(); i++) hash = (hash ^ (unsigned char)header[i]) * PRIME;
+
+    for (int i = 0; i < (int)m_sources.size(); i++)
+    {
+        std::ifstream file(m_sources[i].filepath, std::ios::binary);
+        std::ostringstream limits;
+        limits << m_sources[i].max_width << 'x' << m_sources[i].max_height;
+
+        std::string contents = m_sources[i].name + '\0' + limits.str() + '\0' +
+            std::string(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+        for (int j = 0; j < (int)contents.size(); j++) hash = (hash ^ (unsigned char)contents[j]) * PRIME;
+    }
+
+    return hash;
+}
+
+bool TextureAtlas::load_cache(const char* cache_filepath, unsigned long long key)
+{
+    std::ifstream file(cache_filepath, std::ios::binary | std::ios::ate);
+    if (file.fail()) return false;
+
+    // Every count and size in the file is checked against what is left of it
+    // before anything is allocated, so a corrupt or truncated cache means a
+    // rebuild rather than a huge allocation or a page that does not exist
+    std::streamoff file_size = file.tellg();
+    file.seekg(0);
+    auto fits = [&file, file_size](unsigned long long size) {
+        return !file.fail() && size <= (unsigned long long)(file_size - file.tellg());
+    };
+    auto reject = [this]() {
+        m_pages.clear();
+        m_regions.clear();
+        return false;
+    };
+
+    unsigned int magic = 0, version = 0, page_count = 0, region_count = 0;
+    unsigned long long cached_key = 0;
+
+    file.read((char*)&magic, sizeof(magic));
+    file.read((char*)&version, sizeof(version));
+    file.read((char*)&cached_key, sizeof(cached_key));
+
+    if (file.fail() || magic != ATLAS_CACHE_MAGIC || version != ATLAS_CACHE_VERSION || cached_key != key) return false;
+
+    file.read((char*)&page_count, sizeof(page_count));
+    if (!fits((unsigned long long)page_count * 2 * sizeof(int))) return reject();
+    m_pages.resize(page_count);
+
+    for (int i = 0; i < (int)page_count; i++)
+    {
+        file.read((char*)&m_pages[i].width, sizeof(int));
+        file.read((char*)&m_pages[i].height, sizeof(int));
+
+        if (m_pages[i].width <= 0 || m_pages[i].width > MAX_PAGE_SIZE ||
+            m_pages[i].height <= 0 || m_pages[i].height > MAX_PAGE_SIZE) return reject();
+
+        size_t pixel_size = (size_t)m_pages[i].width * m_pages[i].height * 4;
+        if (!fits(pixel_size)) return reject();
+        m_pages[i].pixels.resize(pixel_size);
+        file.read((char*)m_pages[i].pixels.data(), m_pages[i].pixels.size());
+
+        // Sizes all follow from the page's, and whether the levels are kept
+        // compressed or as RGBA is part of the key
+        m_pages[i].mips.resize(m_compress ? 0 : MIP_LEVELS - 1);
+        for (int level = 1; level <= (int)m_pages[i].mips.size(); level++)
+        {
+            std::vector<unsigned char> &mip = m_pages[i].mips[level - 1];
+            mip.resize((size_t)level_size(m_pages[i].width, level) * level_size(m_pages[i].height, level) * 4);
+            file.read((char*)mip.data(), mip.size());
+        }
+
+        m_pages[i].compressed.resize(m_compress ? MIP_LEVELS : 0);
+        for (int level = 0; level < (int)m_pages[i].compressed.size(); level++)
+        {
+            std::vector<unsigned char> &blocks = m_pages[i].compressed[level];
+            blocks.resize(bc3_compressed_size(level_size(m_pages[i].width, level), level_size(m_pages[i].height, level)));
+            file.read((char*)blocks.data(), blocks.size());
+        }
+
+        if (file.fail()) return reject();
+    }
+
+    file.read((char*)&region_count, sizeof(region_count));
+    if (!fits((unsigned long long)region_count * (sizeof(unsigned int) + 5 * sizeof(int)))) return reject();
+
+    for (int i = 0; i < (int)region_count; i++)
+    {
+        unsigned int name_length = 0;
+        file.read((char*)&name_length, sizeof(name_length));
+        if (!fits(name_length)) return reject();
+
+        std::string name(name_length, '\0');
+        file.read(&name[0], name_length);
+
+        AtlasRegion region;
+        file.read((char*)&region.page, sizeof(int));
+        file.read((char*)&region.x, sizeof(int));
+        file.read((char*)&region.y, sizeof(int));
+        file.read((char*)&region.width, sizeof(int));
+        file.read((char*)&region.height, sizeof(int));
+        file.read((char*)&region.uv_rect, sizeof(region.uv_rect));
+
+        if (file.fail() || region.page < 0 || region.page >= (int)page_count) return reject();
+
+        m_regions[name] = region;
+    }
+
+    if (file.fail()) return reject();
+
+    return true;
+}
+
+void TextureAtlas::save_cache(const char* cache_filepath, unsigned long long key) const
+{
+    std::ofstream file(cache_filepath, std::ios::binary);
+
+    if (file.fail())
+    {
+        std::cout << "Unable to write atlas cache " << cache_filepath << std::endl;
+        return;
+    }
+
+    unsigned int page_count = (unsigned int)m_pages.size();
+    unsigned int region_count = (unsigned int)m_regions.size();
+
+    file.write((const char*)&ATLAS_CACHE_MAGIC, sizeof(ATLAS_CACHE_MAGIC));
+    file.write((const char*)&ATLAS_CACHE_VERSION, sizeof(ATLAS_CACHE_VERSION));
+    file.write((const char*)&key, sizeof(key));
+
+    file.write((const char*)&page_count, sizeof(page_count));
+    for (int i = 0; i < (int)m_pages.size(); i++)
+    {
+        file.write((const char*)&m_pages[i].width, sizeof(int));
+        file.write((const char*)&m_pages[i].height, sizeof(int));
+        file.write((const char*)m_pages[i].pixels.data(), m_pages[i].pixels.size());
+
+        for (int level = 0; level < (int)m_pages[i].mips.size(); level++)
+        {
+            file.write((const char*)m_pages[i].mips[level].data(), m_pages[i].mips[level].size());
+        }
+        for (int level = 0; level < (int)m_pages[i].compressed.size(); level++)
+        {
+            file.write((const char*)m_pages[i].compressed[level].data(), m_pages[i].compressed[level].size());
+        }
+    }
+
+    file.write((const char*)&region_count, sizeof(region_count));
+    for (std::map<std::string, AtlasRegion>::const_iterator it = m_regions.begin(); it != m_regions.end(); ++it)
+    {
+        unsigned int name_length = (unsigned int)it->first.size();
+        file.write((const char*)&name_length, sizeof(name_length));
+        file.write(it->first.data(), name_length);
+
+        file.write((const char*)&it->second.page, sizeof(int));
+        file.write((const char*)&it->second.x, sizeof(int));
+        file.write((const char*)&it->second.y, sizeof(int));
+        file.write((const char*)&it->second.width, sizeof(int));
+        file.write((const char*)&it->second.height, sizeof(int));
+        file.write((const char*)&it->second.uv_rect, sizeof(it->second.uv_rect));
+    }
+}
+
+// ––––– PACKING ––––– //
+bool TextureAtlas::find_position(const Page &page, int width, int height, int* node_index, int* x, int* y) const
+{
+    int best_y = m_page_size, best_width = m_page_size;
+    *node_index = -1;
+
+    for (int i = 0; i < (int)page.skyline.size(); i++)
+    {
+        int left = page.skyline[i].x;
+        if (left + width > m_page_size) break;
+
+        // The rect rests on the highest node it spans
+        int top = 0, spanned = 0;
+        for (int j = i; spanned < width; j++)
+        {
+            top = std::max(top, page.skyline[j].y);
+            spanned = page.skyline[j].x + page.skyline[j].width - left;
+        }
+
+        if (top + height > m_page_size) continue;
+
+        // Bottom-left rule: lowest position first, narrowest node on ties
+        if (top < best_y || (top == best_y && page.skyline[i].width < best_width))
+        {
+            best_y = top;
+            best_width = page.skyline[i].width;
+            *node_index = i;
+            *x = left;
+            *y = top;
+        }
+    }
+
+    return *node_index >= 0;
+}
+
+void TextureAtlas::insert_node(Page &page, int node_index, int x, int y, int width, int height)
+{
+    SkylineNode node = { x, y + height, width };
+    page.skyline.insert(page.skyline.begin() + node_index, node);
+
+    // Shrink or drop the nodes now hidden under the new one
+    for (int i = node_index + 1; i < (int)page.skyline.size(); i++)
+    {
+        SkylineNode &previous = page.skyline[i - 1];
+        SkylineNode &current = page.skyline[i];
+
+        int overlap = previous.x + previous.width - current.x;
+        if (overlap <= 0) break;
+
+        current.x += overlap;
+        current.width -= overlap;
+
+        if (current.width > 0) break;
+
+        page.skyline.erase(page.skyline.begin() + i);
+        i--;
+    }
+
+    // Merge neighbours at the same height
+    for (int i = 0; i < (int)page.skyline.size() - 1; i++)
+    {
+        if (page.skyline[i].y == page.skyline[i + 1].y)
+        {
+            page.skyline[i].width += page.skyline[i + 1].width;
+            page.skyline.erase(page.skyline.begin() + i + 1);
+            i--;
+        }
+    }
+}
+
+void TextureAtlas::pack()
+{
+    struct Image
+    {
+        unsigned char* pixels;
+        std::vector<unsigned char> resized; // owns pixels when the image was shrunk
+        int width, height;
+        int page, x, y;
+    };
+
+    std::vector<Image> images(m_sources.size());
+    std::vector<int> order;
+
+    // STEP 1: Decode on every core. The bundled stb_image keeps its failure
+    //         string per thread and its fixed Huffman tables constant, so
+    //         separate stbi_load calls share no writable state.
+    std::atomic<int> next_image(0);
+    auto decode = [this, &images, &next_image]() {
+        for (int i = next_image++; i < (int)images.size(); i = next_image++)
+        {
+            int number_of_components;
+            Image &image = images[i];
+
+            image.pixels = stbi_load(m_sources[i].filepath.c_str(), &image.width, &image.height,
+                &number_of_components, STBI_rgb_alpha);
+            image.page = -1;
+
+            // Texels beyond what the screen can ever show only cost memory and
+            // upload time, so images larger than their limit are shrunk to it
+            const Source &source = m_sources[i];
+            int width = source.max_width > 0 ? std::min(image.width, source.max_width) : image.width;
+            int height = source.max_height > 0 ? std::min(image.height, source.max_height) : image.height;
+
+            if (image.pixels != NULL && (width < image.width || height < image.height))
+            {
+                image.resized.resize((size_t)width * height * 4);
+                resize_rgba(image.pixels, image.width, image.height, image.resized.data(), width, height);
+                stbi_image_free(image.pixels);
+
+                image.pixels = image.resized.data();
+                image.width = width;
+                image.height = height;
+            }
+        }
+    };
+
+    int worker_count = std::min((int)std::thread::hardware_concurrency(), (int)images.size()) - 1;
+    std::vector<std::thread> workers;
+    for (int i = 0; i < worker_count; i++) workers.push_back(std::thread(decode));
+    decode();
+    for (int i = 0; i < (int)workers.size(); i++) workers[i].join();
+
+    for (int i = 0; i < (int)m_sources.size(); i++)
+    {
+        Image &image = images[i];
+
+        if (image.pixels == NULL)
+        {
+            std::cout << "Unable to load image " << m_sources[i].filepath << ". Make sure the path is correct." << std::endl;
+            continue;
+        }
+
+        if (!image.resized.empty())
+        {
+            std::cout << "Shrunk " << m_sources[i].name << " to " << image.width << "x" << image.height << std::endl;
+        }
+
+        if (image.width + 2 * PADDING > m_page_size || image.height + 2 * PADDING > m_page_size)
+        {
+            std::cout << "Image " << m_sources[i].filepath << " does not fit in an atlas page" << std::endl;
+            continue;
+        }
+
+        order.push_back(i);
+    }
+
+    // Tallest first keeps the skyline flat
+    std::sort(order.begin(), order.end(), [&images](int a, int b) {
+        if (images[a].height != images[b].height) return images[a].height > images[b].height;
+        return images[a].width > images[b].width;
+    });
+
+    m_pages.clear();
+
+    // Rounding every padded size up to a multiple of PADDING keeps every
+    // position a multiple of it too, so images start on whole texels in
+    // every mip level
+    auto padded = [](int size) { return (size + 2 * PADDING + PADDING - 1) / PADDING * PADDING; };
+
+    for (int i = 0; i < (int)order.size(); i++)
+    {
+        Image &image = images[order[i]];
+        int padded_width = padded(image.width);
+        int padded_height = padded(image.height);
+
+        for (int p = 0; p <= (int)m_pages.size() && image.page < 0; p++)
+        {
+            if (p == (int)m_pages.size())
+            {
+                Page page;
+                SkylineNode ground = { 0, 0, m_page_size };
+                page.skyline.push_back(ground);
+                m_pages.push_back(page);
+            }
+
+            int node_index;
+            if (find_position(m_pages[p], padded_width, padded_height, &node_index, &image.x, &image.y))
+            {
+                insert_node(m_pages[p], node_index, image.x, image.y, padded_width, padded_height);
+                image.page = p;
+
+                m_pages[p].width = std::max(m_pages[p].width, image.x + padded_width);
+                m_pages[p].height = std::max(m_pages[p].height, image.y + padded_height);
+            }
+        }
+    }
+
+    // Pages are trimmed to what was used before any pixels are allocated
+    for (int p = 0; p < (int)m_pages.size(); p++)
+    {
+        m_pages[p].pixels.assign((size_t)m_pages[p].width * m_pages[p].height * 4, 0);
+    }
+
+    m_regions.clear();
+
+    for (int i = 0; i < (int)images.size(); i++)
+    {
+        Image &image = images[i];
+        AtlasRegion region;
+
+        if (image.page >= 0)
+        {
+            Page &page = m_pages[image.page];
+
+            // Copy the image and extrude its edge pixels into all of the padding
+            int right_padding = padded(image.width) - image.width - PADDING;
+            int bottom_padding = padded(image.height) - image.height - PADDING;
+
+            for (int row = -PADDING; row < image.height + bottom_padding; row++)
+            {
+                int source_row = std::min(std::max(row, 0), image.height - 1);
+                unsigned char* destination = &page.pixels[((size_t)(image.y + PADDING + row) * page.width + image.x) * 4];
+                const unsigned char* source = &image.pixels[(size_t)source_row * image.width * 4];
+
+                for (int column = 0; column < PADDING; column++) memcpy(destination + column * 4, source, 4);
+                for (int column = 0; column < right_padding; column++)
+                {
+                    memcpy(destination + (PADDING + image.width + column) * 4, source + (image.width - 1) * 4, 4);
+                }
+                memcpy(destination + PADDING * 4, source, (size_t)image.width * 4);
+            }
+
+            region.page = image.page;
+            region.x = image.x + PADDING;
+            region.y = image.y + PADDING;
+            region.width = image.width;
+            region.height = image.height;
+            region.uv_rect = glm::vec4(
+                (float)region.x / page.width, (float)region.y / page.height,
+                (float)(region.x + region.width) / page.width, (float)(region.y + region.height) / page.height);
+        }
+
+        m_regions[m_sources[i].name] = region;
+
+        if (image.pixels != NULL && image.resized.empty()) stbi_image_free(image.pixels);
+    }
+}
+
+// ––––– MIPS AND COMPRESSION ––––– //
+void TextureAtlas::build_mip_levels()
+{
+    for (int p = 0; p < (int)m_pages.size(); p++)
+    {
+        Page &page = m_pages[p];
+        page.mips.resize(MIP_LEVELS - 1);
+
+        for (int level = 1; level < MIP_LEVELS; level++)
+        {
+            const std::vector<unsigned char> &source = level == 1 ? page.pixels : page.mips[level - 2];
+            int source_width = level_size(page.width, level - 1), source_height = level_size(page.height, level - 1);
+            int width = level_size(page.width, level), height = level_size(page.height, level);
+
+            std::vector<unsigned char> &mip = page.mips[level - 1];
+            mip.resize((size_t)width * height * 4);
+
+            // 2x2 box filter, with colour weighted by alpha so transparent
+            // texels never darken the edges they border
+            for (int y = 0; y < height; y++)
+            {
+                for (int x = 0; x < width; x++)
+                {
+                    int sum[4] = { 0, 0, 0, 0 };
+
+                    for (int i = 0; i < 4; i++)
+                    {
+                        int source_x = std::min(x * 2 + i % 2, source_width - 1);
+                        int source_y = std::min(y * 2 + i / 2, source_height - 1);
+                        const unsigned char* texel = &source[((size_t)source_y * source_width + source_x) * 4];
+
+                        for (int c = 0; c < 3; c++) sum[c] += texel[c] * texel[3];
+                        sum[3] += texel[3];
+                    }
+
+                    unsigned char* destination = &mip[((size_t)y * width + x) * 4];
+                    for (int c = 0; c < 3; c++) destination[c] = sum[3] > 0 ? (unsigned char)((sum[c] + sum[3] / 2) / sum[3]) : 0;
+                    destination[3] = (unsigned char)((sum[3] + 2) / 4);
+                }
+            }
+        }
+    }
+}
+
+void TextureAtlas::compress_levels()
+{
+    const int ROWS_PER_JOB = 16; // block rows
+
+    struct Job { int page, level, first_row, last_row; };
+    std::vector<Job> jobs;
+
+    for (int p = 0; p < (int)m_pages.size(); p++)
+    {
+        Page &page = m_pages[p];
+        page.compressed.resize(MIP_LEVELS);
+
+        for (int level = 0; level < MIP_LEVELS; level++)
+        {
+            int width = level_size(page.width, level), height = level_size(page.height, level);
+            page.compressed[level].resize(bc3_compressed_size(width, height));
+
+            int block_rows = (height + 3) / 4;
+            for (int row = 0; row < block_rows; row += ROWS_PER_JOB)
+            {
+                Job job = { p, level, row, std::min(row + ROWS_PER_JOB, block_rows) };
+                jobs.push_back(job);
+            }
+        }
+    }
+
+    // Like decoding, spread over every core
+    std::atomic<int> next_job(0);
+    auto compress = [this, &jobs, &next_job]() {
+        for (int i = next_job++; i < (int)jobs.size(); i = next_job++)
+        {
+            const Job &job = jobs[i];
+            Page &page = m_pages[job.page];
+            const std::vector<unsigned char> &pixels = job.level == 0 ? page.pixels : page.mips[job.level - 1];
+
+            compress_bc3(pixels.data(), level_size(page.width, job.level), level_size(page.height, job.level),
+                job.first_row, job.last_row, page.compressed[job.level].data());
+        }
+    };
+
+    int worker_count = std::min((int)std::thread::hardware_concurrency(), (int)jobs.size()) - 1;
+    std::vector<std::thread> workers;
+    for (int i = 0; i < worker_count; i++) workers.push_back(std::thread(compress));
+    compress();
+    for (int i = 0; i < (int)workers.size(); i++) workers[i].join();
+
+    // Only the compressed levels are uploaded, and level 0 stays in `pixels`
+    for (int p = 0; p < (int)m_pages.size(); p++) std::vector<std::vector<unsigned char> >().swap(m_pages[p].mips);
+}
+
+void TextureAtlas::decompress_levels()
+{
+    for (int p = 0; p < (int)m_pages.size(); p++)
+    {
+        Page &page = m_pages[p];
+        page.mips.resize(MIP_LEVELS - 1);
+
+        for (int level = 0; level < (int)page.compressed.size(); level++)
+        {
+            int width = level_size(page.width, level), height = level_size(page.height, level);
+            std::vector<unsigned char> &pixels = level == 0 ? page.pixels : page.mips[level - 1];
+
+            pixels.resize((size_t)width * height * 4);
+            decompress_bc3(page.compressed[level].data(), width, height, pixels.data());
+        }
+    }
+}
+
+void TextureAtlas::upload()
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    size_t uploaded_bytes = 0, full_size_bytes = 0;
+
+    // A CPU copy has to hold what GL samples: every level, and with
+    // compression those levels as they decode from BC3
+    if (m_keep_pixels && m_compress) decompress_levels();
+    else if (m_keep_pixels && !m_pages.empty() && m_pages[0].mips.empty()) build_mip_levels();
+
+    // Without a context a page only needs a name for its CPU copy: level 0
+    // and the mips, which the software rasteriser blends like GL does
+    if (!gl_has_context())
+    {
+        for (int p = 0; p < (int)m_pages.size(); p++)
+        {
+            Page &page = m_pages[p];
+            page.texture_id = gl_gen_texture();
+            full_size_bytes += page.pixels.size();
+
+            std::vector<std::vector<unsigned char> >().swap(page.compressed);
+        }
+
+        std::cout << "Atlas: " << m_pages.size() << " pages, " << full_size_bytes / 1024
+                  << " KB kept on the CPU (no GL context)" << std::endl;
+        return;
+    }
+
+    for (int p = 0; p < (int)m_pages.size(); p++)
+    {
+        Page &page = m_pages[p];
+
+        glGenTextures(1, &page.texture_id);
+        gl_bind_texture(page.texture_id);
+
+        for (int level = 0; level < MIP_LEVELS; level++)
+        {
+            int width = level_size(page.width, level), height = level_size(page.height, level);
+
+            if (m_compress)
+            {
+                glCompressedTexImage2D(GL_TEXTURE_2D, level, GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, width, height, 0,
+                    (GLsizei)page.compressed[level].size(), page.compressed[level].data());
+                uploaded_bytes += page.compressed[level].size();
+            }
+            else
+            {
+                const std::vector<unsigned char> &pixels = level == 0 ? page.pixels : page.mips[level - 1];
+                glTexImage2D(GL_TEXTURE_2D, level, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE,
+                    pixels.data());
+                uploaded_bytes += pixels.size();
+            }
+        }
+        full_size_bytes += page.pixels.size();
+
+        // Minification blends between levels; magnification stays as sharp as it was
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, MIP_LEVELS - 1);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+
+        // The GPU copy is all we need from here on, unless asked otherwise
+        std::vector<std::vector<unsigned char> >().swap(page.compressed);
+        if (!m_keep_pixels)
+        {
+            std::vector<unsigned char>().swap(page.pixels);
+            std::vector<std::vector<unsigned char> >().swap(page.mips);
+        }
+    }
+
+    std::cout << "Atlas: " << m_pages.size() << " pages, " << uploaded_bytes / 1024 << " KB as "
+              << (m_compress ? "BC3" : "RGBA8") << " with " << MIP_LEVELS << " mip levels (RGBA8 without mips: "
+              << full_size_bytes / 1024 << " KB), uploaded in "
+              << std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count()
+              << " ms" << std::endl;
+}
+
+void TextureAtlas::build(const char* cache_filepath)
+{
+    start_build(cache_filepath);
+    finish_build();
+}
+
+void TextureAtlas::start_build(const char* cache_filepath)
+{
+    // The only GL calls of the whole build; everything up to the upload runs
+    // on a worker, in parallel with whatever the caller does next. Without a
+    // context the pages are laid out as a GPU with BC3 would get them, so the
+    // cache stays shared with GL runs.
+    if (gl_has_context())
+    {
+        GLint max_texture_size = 0;
+        glGetIntegerv(GL_MAX_TEXTURE_SIZE, &max_texture_size);
+        m_page_size = std::min((int)max_texture_size, (int)MAX_PAGE_SIZE);
+
+        m_compress = m_compression_allowed && gl_has_extension("GL_EXT_texture_compression_s3tc");
+    }
+    else
+    {
+        m_page_size = MAX_PAGE_SIZE;
+        m_compress = m_compression_allowed;
+    }
+
+    std::string cache = cache_filepath;
+
+    m_build_thread = std::thread([this, cache]() {
+        unsigned long long key = hash_sources();
+
+        if (!load_cache(cache.c_str(), key))
+        {
+            pack();
+            build_mip_levels();
+            if (m_compress) compress_levels();
+            save_cache(cache.c_str(), key);
+        }
+    });
+}
+
+void TextureAtlas::finish_build()
+{
+    if (m_build_thread.joinable()) m_build_thread.join();
+
+    upload();
+}
+
+void TextureAtlas::cleanup()
+{
+    for (int p = 0; p < (int)m_pages.size(); p++)
+    {
+        gl_delete_texture(m_pages[p].texture_id);
+    }
+
+    m_pages.clear();
+    m_regions.clear();
+}
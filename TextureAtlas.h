@@ -0,0 +1,122 @@
+#pragma once
+
+#ifdef _WINDOWS
+    #include <GL/glew.h>
+#endif
+#define GL_GLEXT_PROTOTYPES 1
+#include <SDL_opengl.h>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+#include "glm/vec2.hpp"
+#include "glm/vec4.hpp"
+
+struct AtlasRegion
+{
+    int page = 0;
+    int x = 0, y = 0;
+    int width = 0, height = 0;
+    glm::vec4 uv_rect = glm::vec4(0.0f); // (u0, v0, u1, v1), v0 at the top edge
+
+    // UV rect of one cell when the region is a cols x rows sprite sheet
+    glm::vec4 const cell(int index, int cols, int rows) const;
+};
+
+// Packs every sprite into as few textures as possible so that rendering rarely
+// has to switch textures. Images are registered by name, packed with a skyline
+// bottom-left packer and padded with their own edge pixels so neighbours never
+// bleed into each other.
+//
+// Sprites are mostly drawn far smaller than their source images, so every
+// page gets a mip chain. Images sit on PADDING-aligned positions with PADDING
+// texels around them, which leaves at least one texel of padding even in the
+// smallest level. Where the driver reads S3TC, every level is also compressed
+// to BC3, a quarter of the size of RGBA8 (see TextureCompression). Images can
+// also be given the largest size they are ever drawn at, and are shrunk to it
+// before packing (see ImageResize).
+//
+// The packed pages, mips and compressed levels are written to a cache file
+// together with a hash of every source file; as long as no source changes,
+// later startups load the pages straight from the cache and skip decoding,
+// packing and compressing. Images are decoded on all cores.
+class TextureAtlas
+{
+private:
+    static const int MIP_LEVELS = 5;
+    static const int PADDING = 1 << (MIP_LEVELS - 1);
+    static const int MAX_PAGE_SIZE = 4096;
+
+    struct SkylineNode { int x, y, width; };
+
+    struct Page
+    {
+        int width = 0, height = 0;
+        std::vector<unsigned char> pixels;                   // level 0, RGBA
+        std::vector<std::vector<unsigned char> > mips;       // levels 1 and up, RGBA
+        std::vector<std::vector<unsigned char> > compressed; // every level as BC3, when compressing
+        std::vector<SkylineNode> skyline;
+        GLuint texture_id = 0;
+    };
+
+    struct Source
+    {
+        std::string name;
+        std::string filepath;
+        int max_width = 0, max_height = 0; // 0 for no limit
+    };
+
+    std::vector<Source> m_sources;
+    std::vector<Page> m_pages;
+    std::map<std::string, AtlasRegion> m_regions;
+    int m_page_size = MAX_PAGE_SIZE;
+    bool m_keep_pixels = false;
+    bool m_compression_allowed = true;
+    bool m_compress = false; // decided at start_build, from what the driver reads
+    std::thread m_build_thread;
+
+    unsigned long long hash_sources() const;
+    bool load_cache(const char* cache_filepath, unsigned long long key);
+    void save_cache(const char* cache_filepath, unsigned long long key) const;
+
+    void pack();
+    bool find_position(const Page &page, int width, int height, int* node_index, int* x, int* y) const;
+    void insert_node(Page &page, int node_index, int x, int y, int width, int height);
+    void build_mip_levels();
+    void compress_levels();
+    void decompress_levels();
+    void upload();
+
+public:
+    // Images bigger than `max_size` are shrunk to it (per axis, 0 for no limit)
+    // before packing; the cache keeps the shrunk copy
+    void add_image(const std::string &name, const char* filepath, const glm::ivec2 &max_size = glm::ivec2(0));
+    void build(const char* cache_filepath);
+
+    // build in two halves, so decoding and packing overlap other startup work.
+    // No region may be read until finish_build has returned.
+    void start_build(const char* cache_filepath);
+    void finish_build();
+    void cleanup();
+
+    // Keeps a CPU copy of every page and its mips after the upload, for
+    // renderers that do not sample from the GPU (see SoftwareRasteriser).
+    // Call before building.
+    void set_keep_pixels(bool keep) { m_keep_pixels = keep; };
+    // Compression is used wherever the driver supports it unless this turns it off
+    void set_compression_allowed(bool allowed) { m_compression_allowed = allowed; };
+
+    const AtlasRegion &get_region(const std::string &name) const;
+    GLuint const get_texture_id(int page)          const { return m_pages[page].texture_id; };
+    GLuint const get_texture_id(const AtlasRegion &region) const { return m_pages[region.page].texture_id; };
+    int    const get_page_count()                  const { return (int)m_pages.size();       };
+    int    const get_page_width(int page)          const { return m_pages[page].width;       };
+    int    const get_page_height(int page)         const { return m_pages[page].height;      };
+
+    // RGBA, top row first, as GL samples it (so decoded from BC3 when
+    // compressing); empty unless set_keep_pixels was called
+    const std::vector<unsigned char> &get_page_pixels(int page) const { return m_pages[page].pixels; };
+    // Levels 1 and up of the same, each half the size of the one before (at
+    // least 1), as GL samples them with GL_LINEAR_MIPMAP_LINEAR
+    const std::vector<std::vector<unsigned char> > &get_page_mips(int page) const { return m_pages[page].mips; };
+};
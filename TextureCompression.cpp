@@ -0,0 +1,230 @@
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include "TextureCompression.h"
+
+int bc3_compressed_size(int width, int height)
+{
+    return ((width + 3) / 4) * ((height + 3) / 4) * BC3_BLOCK_SIZE;
+}
+
+// ––––– ALPHA ––––– //
+// Endpoints are the block's extremes; with a0 > a1 the six values between
+// them are spread evenly, index 0 is a0, index 1 is a1 and 2-7 run from a0
+// towards a1.
+static void encode_alpha(const unsigned char texels[16][4], unsigned char* block)
+{
+    int highest = 0, lowest = 255;
+    for (int i = 0; i < 16; i++)
+    {
+        highest = std::max(highest, (int)texels[i][3]);
+        lowest = std::min(lowest, (int)texels[i][3]);
+    }
+
+    block[0] = (unsigned char)highest;
+    block[1] = (unsigned char)lowest;
+
+    int palette[8] = { highest, lowest };
+    for (int i = 2; i < 8; i++) palette[i] = ((8 - i) * highest + (i - 1) * lowest + 3) / 7;
+
+    unsigned long long indices = 0;
+    for (int i = 0; i < 16; i++)
+    {
+        int best = 0, best_error = 256;
+        for (int p = 0; p < 8 && highest != lowest; p++)
+        {
+            int error = abs(palette[p] - texels[i][3]);
+            if (error < best_error)
+            {
+                best = p;
+                best_error = error;
+            }
+        }
+
+        indices |= (unsigned long long)best << (3 * i);
+    }
+
+    for (int i = 0; i < 6; i++) block[2 + i] = (unsigned char)(indices >> (8 * i));
+}
+
+// ––––– COLOUR ––––– //
+static int to_565(const int* rgb)
+{
+    return ((rgb[0] * 31 + 127) / 255) << 11 | ((rgb[1] * 63 + 127) / 255) << 5 | ((rgb[2] * 31 + 127) / 255);
+}
+
+static void from_565(int colour, int* rgb)
+{
+    int r = (colour >> 11) & 31, g = (colour >> 5) & 63, b = colour & 31;
+
+    rgb[0] = (r << 3) | (r >> 2);
+    rgb[1] = (g << 2) | (g >> 4);
+    rgb[2] = (b << 3) | (b >> 2);
+}
+
+// Endpoints are opposite corners of the bounding box of the visible texels,
+// pulled in by a sixteenth of its size so the in-between colours land on more
+// of them. Of the box's four diagonals, the one the colours actually run
+// along is picked from the sign of their covariance with the widest channel.
+static void encode_colour(const unsigned char texels[16][4], unsigned char* block)
+{
+    int low[3] = { 255, 255, 255 }, high[3] = { 0, 0, 0 }, sum[3] = { 0, 0, 0 };
+    bool visible[16];
+    int visible_count = 0;
+
+    for (int pass = 0; pass < 2 && visible_count == 0; pass++)
+    {
+        for (int i = 0; i < 16; i++)
+        {
+            // Fully transparent texels never show, so their colour is free
+            visible[i] = pass == 1 || texels[i][3] > 0;
+            if (!visible[i]) continue;
+
+            for (int c = 0; c < 3; c++)
+            {
+                low[c] = std::min(low[c], (int)texels[i][c]);
+                high[c] = std::max(high[c], (int)texels[i][c]);
+                sum[c] += texels[i][c];
+            }
+            visible_count++;
+        }
+    }
+
+    int widest = 0;
+    for (int c = 1; c < 3; c++) if (high[c] - low[c] > high[widest] - low[widest]) widest = c;
+
+    for (int c = 0; c < 3; c++)
+    {
+        int covariance = 0;
+        for (int i = 0; i < 16; i++)
+        {
+            if (!visible[i]) continue;
+            covariance += (texels[i][c] * visible_count - sum[c]) * (texels[i][widest] * visible_count - sum[widest]) / 256;
+        }
+
+        int inset = (high[c] - low[c]) / 16;
+        low[c] += inset;
+        high[c] -= inset;
+
+        if (covariance < 0) std::swap(low[c], high[c]);
+    }
+
+    // BC3 always decodes colour in four-colour mode; keeping colour0 the
+    // larger also makes the block valid as BC1
+    int colour0 = to_565(high), colour1 = to_565(low);
+    if (colour0 < colour1) std::swap(colour0, colour1);
+
+    block[0] = (unsigned char)colour0;
+    block[1] = (unsigned char)(colour0 >> 8);
+    block[2] = (unsigned char)colour1;
+    block[3] = (unsigned char)(colour1 >> 8);
+
+    int palette[4][3];
+    from_565(colour0, palette[0]);
+    from_565(colour1, palette[1]);
+    for (int c = 0; c < 3; c++)
+    {
+        palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+        palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+    }
+
+    unsigned int indices = 0;
+    for (int i = 0; i < 16; i++)
+    {
+        int best = 0, best_error = 0x7FFFFFFF;
+        for (int p = 0; p < 4 && colour0 != colour1; p++)
+        {
+            int error = 0;
+            for (int c = 0; c < 3; c++) error += (palette[p][c] - texels[i][c]) * (palette[p][c] - texels[i][c]);
+
+            if (error < best_error)
+            {
+                best = p;
+                best_error = error;
+            }
+        }
+
+        indices |= (unsigned int)best << (2 * i);
+    }
+
+    for (int i = 0; i < 4; i++) block[4 + i] = (unsigned char)(indices >> (8 * i));
+}
+
+void compress_bc3(const unsigned char* rgba, int width, int height, int first_row, int last_row,
+                  unsigned char* blocks)
+{
+    int blocks_across = (width + 3) / 4;
+
+    for (int block_y = first_row; block_y < last_row; block_y++)
+    {
+        for (int block_x = 0; block_x < blocks_across; block_x++)
+        {
+            // Blocks hanging over the edge repeat the edge texels
+            unsigned char texels[16][4];
+            for (int i = 0; i < 16; i++)
+            {
+                int x = std::min(block_x * 4 + i % 4, width - 1);
+                int y = std::min(block_y * 4 + i / 4, height - 1);
+                memcpy(texels[i], &rgba[((size_t)y * width + x) * 4], 4);
+            }
+
+            unsigned char* block = &blocks[((size_t)block_y * blocks_across + block_x) * BC3_BLOCK_SIZE];
+            encode_alpha(texels, block);
+            encode_colour(texels, block + 8);
+        }
+    }
+}
+
+void decompress_bc3(const unsigned char* blocks, int width, int height, unsigned char* rgba)
+{
+    int blocks_across = (width + 3) / 4, blocks_down = (height + 3) / 4;
+
+    for (int block_y = 0; block_y < blocks_down; block_y++)
+    {
+        for (int block_x = 0; block_x < blocks_across; block_x++)
+        {
+            const unsigned char* block = &blocks[((size_t)block_y * blocks_across + block_x) * BC3_BLOCK_SIZE];
+
+            // Alpha: eight values when a0 > a1, otherwise six plus 0 and 255
+            int alpha[8] = { block[0], block[1] };
+            if (alpha[0] > alpha[1])
+            {
+                for (int i = 2; i < 8; i++) alpha[i] = ((8 - i) * alpha[0] + (i - 1) * alpha[1]) / 7;
+            }
+            else
+            {
+                for (int i = 2; i < 6; i++) alpha[i] = ((6 - i) * alpha[0] + (i - 1) * alpha[1]) / 5;
+                alpha[6] = 0;
+                alpha[7] = 255;
+            }
+
+            unsigned long long alpha_indices = 0;
+            for (int i = 0; i < 6; i++) alpha_indices |= (unsigned long long)block[2 + i] << (8 * i);
+
+            // Colour: always four-colour mode in BC3
+            int palette[4][3];
+            from_565(block[8] | block[9] << 8, palette[0]);
+            from_565(block[10] | block[11] << 8, palette[1]);
+            for (int c = 0; c < 3; c++)
+            {
+                palette[2][c] = (2 * palette[0][c] + palette[1][c]) / 3;
+                palette[3][c] = (palette[0][c] + 2 * palette[1][c]) / 3;
+            }
+
+            unsigned int colour_indices = 0;
+            for (int i = 0; i < 4; i++) colour_indices |= (unsigned int)block[12 + i] << (8 * i);
+
+            // Texels past the edge of the image are dropped
+            for (int i = 0; i < 16; i++)
+            {
+                int x = block_x * 4 + i % 4, y = block_y * 4 + i / 4;
+                if (x >= width || y >= height) continue;
+
+                unsigned char* texel = &rgba[((size_t)y * width + x) * 4];
+                const int* colour = palette[(colour_indices >> (2 * i)) & 3];
+                for (int c = 0; c < 3; c++) texel[c] = (unsigned char)colour[c];
+                texel[3] = (unsigned char)alpha[(alpha_indices >> (3 * i)) & 7];
+            }
+        }
+    }
+}
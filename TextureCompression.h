@@ -0,0 +1,25 @@
+#pragma once
+
+#include <vector>
+
+// Block compression done on the CPU at asset-build time, so the GPU can
+// sample it directly: BC3 (S3TC DXT5), which every desktop driver reads
+// natively through GL_EXT_texture_compression_s3tc.
+//
+// Each 4x4 block takes 16 bytes: alpha as two 8-bit endpoints with six
+// values between them, colour as two RGB565 endpoints with two between
+// them. That is a quarter of RGBA8, whatever the content.
+const int BC3_BLOCK_SIZE = 16;
+
+// Bytes needed for a width x height image; partial blocks at the edges count whole
+int bc3_compressed_size(int width, int height);
+
+// Compresses the block rows [first_row, last_row) of an RGBA image into
+// `blocks`, which must already be bc3_compressed_size bytes. Separate row
+// ranges can be compressed on separate threads.
+void compress_bc3(const unsigned char* rgba, int width, int height, int first_row, int last_row,
+                  unsigned char* blocks);
+
+// The reverse, as a GPU decodes it, into a width x height RGBA image; for CPU
+// copies that have to sample what GL samples
+void decompress_bc3(const unsigned char* blocks, int width, int height, unsigned char* rgba);
@@ -0,0 +1,47 @@
+#pragma once
+
+#include <atomic>
+
+// Hands whole values from one producer thread to one consumer thread without
+// locks. The producer fills its slot and publishes it; the consumer always gets
+// the newest published slot. Neither side ever waits for the other: a slow
+// consumer just skips values, and a slow producer just sees the same value
+// again.
+//
+// Three slots make this work: one owned by each side and one in the middle.
+// Publishing and acquiring both swap their slot with the middle one.
+template <typename T>
+class TripleBuffer
+{
+private:
+    static const int INDEX_MASK = 3;
+    static const int NEW_DATA = 4; // set in m_middle while it holds an unread value
+
+    T m_slots[3];
+    std::atomic<int> m_middle;
+    int m_write_index = 0; // only touched by the producer
+    int m_read_index = 1;  // only touched by the consumer
+
+public:
+    TripleBuffer() : m_middle(2) {}
+
+    // ––––– PRODUCER ––––– //
+    T &get_write_slot() { return m_slots[m_write_index]; }
+
+    void publish()
+    {
+        m_write_index = m_middle.exchange(m_write_index | NEW_DATA, std::memory_order_acq_rel) & INDEX_MASK;
+    }
+
+    // ––––– CONSUMER ––––– //
+    // Swaps in the newest value, if one was published since the last call
+    bool acquire()
+    {
+        if (!(m_middle.load(std::memory_order_acquire) & NEW_DATA)) return false;
+
+        m_read_index = m_middle.exchange(m_read_index, std::memory_order_acq_rel) & INDEX_MASK;
+        return true;
+    }
+
+    const T &get_read_slot() const { return m_slots[m_read_index]; }
+};
@@ -13,6 +13,7 @@
 #define LOG(argument) std::cout << argument << '\n'
 #define GL_GLEXT_PROTOTYPES 1
 #define FIXED_TIMESTEP 0.0166666f
+#define DEFAULT_FRAME_RATE 60.0f
 #define PLATFORM_COUNT 13
 
 #ifdef _WINDOWS
@@ -24,10 +25,39 @@
 #include "glm/mat4x4.hpp"
 #include "glm/gtc/matrix_transform.hpp"
 #include "ShaderProgram.h"
+#include "ShaderLibrary.h"
 #include "stb_image.h"
 #include "cmath"
 #include <ctime>
+#include <chrono>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <thread>
 #include <vector>
+#include "GLExtensions.h"
+#include "GLState.h"
+#include "SpriteBatch.h"
+#include "TextureAtlas.h"
+#include "TextMesh.h"
+#include "RenderSnapshot.h"
+#include "TripleBuffer.h"
+#include "FramePacer.h"
+#include "StaticLayer.h"
+#include "Profiler.h"
+#include "HeadlessContext.h"
+#include "FrameCapture.h"
+#include "InputReplay.h"
+#include "SoftwareRasteriser.h"
+#include "SdfFont.h"
+#include "Animation.h"
+#include "Camera.h"
+#include "SpatialGrid.h"
+#include "ParallaxBackground.h"
+#include "ParticleRenderer.h"
+#include "JobPool.h"
+#include "ParticleSystem.h"
+#include "RenderQueue.h"
 #include "Entity.h"
 
 //  STRUCTS AND ENUMS  //
@@ -35,7 +65,6 @@ struct GameState
 {
     Entity* player;
     Entity* platforms;
-    Entity* background;
     Entity* points;
 };
 
@@ -53,8 +82,8 @@ VIEWPORT_Y = 0,
 VIEWPORT_WIDTH = WINDOW_WIDTH,
 VIEWPORT_HEIGHT = WINDOW_HEIGHT;
 
-const char V_SHADER_PATH[] = "shaders/vertex_textured.glsl",
-F_SHADER_PATH[] = "shaders/fragment_textured.glsl";
+const char V_SHADER_PATH[] = "shaders/sprite_vertex.glsl",
+F_SHADER_PATH[] = "shaders/sprite_fragment.glsl";
 
 const float MILLISECONDS_IN_SECOND = 1000.0;
 const char SPRITESHEET_FILEPATH[] = "assets/SeamothSprites.png";
@@ -64,25 +93,154 @@ const char REAPER_FILEPATH[] = "assets/ReaperLeviathan.png";
 const char BACKGROUND_FILEPATH[] = "assets/SubnauticaBackground4.png";
 const char POINTS_FILEPATH[] = "assets/Points.png";
 const char FONT_FILEPATH[] = "assets/font1.png";
+const char ATLAS_CACHE_FILEPATH[] = "assets/atlas.cache";
 
 
 constexpr int FONTBANK_SIZE = 16;
 
-const int NUMBER_OF_TEXTURES = 1;
-const GLint LEVEL_OF_DETAIL = 0;
-const GLint TEXTURE_BORDER = 0;
+// What the camera shows, in world units either side of its centre, and the
+// level it may roam. Levels can be many screens wide; ours is still one.
+const float VIEW_HALF_WIDTH = 5.0f,
+VIEW_HALF_HEIGHT = 3.75f;
+const glm::vec2 LEVEL_MIN = glm::vec2(-5.0f, -3.75f),
+LEVEL_MAX = glm::vec2(5.0f, 3.75f);
+
+// Scenery is looked up in a grid of these cells when culling; the margin
+// keeps anything that moved during a step from popping in at the edges
+const float CULL_CELL_SIZE = 2.5f,
+CULL_MARGIN = 0.25f;
+
+// The background image is two depth layers: all of it far away, and the sea
+// floor from this row down in front of it, fading in over its first rows.
+// Scroll is how far a layer moves with the level, from 0 (not at all) to 1.
+const int BACKGROUND_FLOOR_ROW = 250,
+BACKGROUND_FLOOR_FADE_ROWS = 48;
+const float BACKGROUND_FAR_SCROLL = 0.25f,
+BACKGROUND_FLOOR_SCROLL = 0.6f;
+
+// Thrusters stream bubbles; a crash throws out a burst of wreckage. The
+// pool never grows past its capacity, and a full pool drops new particles.
+const int MAX_PARTICLES = 16384;
+const float BUBBLES_PER_SECOND = 60.0f,
+WATER_DRAG = 1.5f;
+const int WRECKAGE_PARTICLES = 150;
+
+const float SEAMOTH_SECONDS_PER_FRAME = 0.25f;
+const int SEAMOTH_SHEET_COLS = 2,
+SEAMOTH_SHEET_ROWS = 1;
 
 //  GLOBAL VARIABLES  //
 GameState g_state;
 
 SDL_Window* g_display_window;
-bool g_game_is_running = true;
-
-ShaderProgram g_program;
-glm::mat4 g_view_matrix, g_projection_matrix;
+SDL_GLContext g_context;
+std::atomic<bool> g_game_is_running(true);
+
+// The simulation publishes a snapshot of what to draw after every step it
+// takes; the render thread, which owns the GL context, always draws the
+// newest one. Neither ever waits for the other.
+TripleBuffer<RenderSnapshot> g_snapshots;
+bool g_use_render_thread = true;
+std::thread g_render_thread;
+
+// Each loop sleeps until it is next due instead of spinning. Frames that
+// would look exactly like the last one presented are not drawn at all.
+FramePacer g_render_pacer, g_simulation_pacer;
+float g_target_frame_rate = DEFAULT_FRAME_RATE; // 0 leaves rendering unpaced
+bool g_low_power = false;
+unsigned long long g_drawn_content = 0;
+float g_drawn_alpha = 0.0f;
+
+ShaderLibrary g_shaders;
+int g_sprite_shader, g_text_shader, g_particle_shader; // feature masks of the variants we draw with
+glm::mat4 g_view_matrix, g_projection_matrix; // the view is the HUD's; sprites use the camera's
+
+// Everything that never moves and could be anywhere in the level, in draw
+// order, indexed by the grid so a frame only looks at what is near the view
+Camera g_camera;
+SpatialGrid g_scenery_grid;
+std::vector<Entity*> g_scenery;
+std::vector<int> g_visible_scenery;
+
+// Thrust is decided by input, once a frame, and emits bubbles in whole
+// numbers as the fixed steps run. --particle-stress <n> keeps the pool
+// topped up to n particles, for measuring.
+ParticleSystem g_particles;
+glm::vec2 g_thrust = glm::vec2(0.0f); // direction the Seamoth is pushing, if any
+float g_bubbles_owed = 0.0f;
+int g_particle_stress = 0;
+
+// --sprite-stress <n> fills the view with n more moving sprites, for
+// measuring how sprite generation scales
+int g_sprite_stress = 0;
+
+ParallaxBackground g_background;
+SpriteBatch g_batch;
+
+// Writes the sprites of long runs of commands into the batch's buffer in
+// parallel. --render-jobs <n> sets how many threads, the render thread
+// included; by default one per core.
+const int MIN_SPRITES_PER_JOB = 512;
+JobPool g_render_jobs;
+int g_render_job_threads = 0;
+ParticleRenderer g_particle_renderer; // when the particle shader is instanced
+StaticLayer g_static_layer;
+
+//  PROFILING  //
+// F3 toggles the overlay; --profile-csv <file> writes the history at exit
+const int PROFILER_REFRESH_FRAMES = 30; // overlay averages over, and updates every, this many frames
+const float PROFILER_MILLISECONDS_PER_BAR = 0.5f;
+const int PROFILER_MAX_BARS = 24;
+
+Profiler g_profiler;
+TextMesh g_profiler_text[PROFILE_SECTION_COUNT];
+float g_simulation_milliseconds[PROFILE_RENDER] = {};
+bool g_show_profiler = false;
+const char* g_profile_csv_filepath = NULL;
+
+//  HEADLESS RENDERING AND REPLAYS  //
+// --headless <frames> draws into an offscreen context instead of a window,
+// on a clock that advances exactly one frame per frame, and --capture
+// <pattern> writes every frame out. --record <file> saves the keys of a run
+// and --replay <file> plays them back.
+HeadlessContext g_headless_context;
+FrameCapture g_capture;
+bool g_headless = false;
+int g_headless_frames = 0;
+float g_headless_frame_rate = DEFAULT_FRAME_RATE; // --fps sets it in headless runs
+const char* g_capture_filepath = NULL;
+
+// --software draws the headless frames on the CPU instead, with no GL
+// context at all: the assets stay in the CPU copies they are built in
+SoftwareRasteriser g_rasteriser;
+bool g_software = false;
+
+InputReplay g_replay;
+bool g_playing_replay = false;
+const char* g_record_filepath = NULL;
+int g_frame_number = 0; // process_input calls so far
+TextureAtlas g_atlas;
+int g_frames_rendered = 0;
+int g_total_draw_calls = 0;
+int g_total_vertices = 0;
+int g_total_gl_calls_skipped = 0;
+int g_total_gl_calls_issued = 0;
+int g_total_sprites_drawn = 0;
+int g_total_sprites_culled = 0;
+int g_total_render_commands = 0;
+int g_total_program_changes = 0;
+int g_total_texture_changes = 0;
+float g_total_generate_milliseconds = 0.0f;
+
+// Everything a frame draws, sorted into draw order by key
+RenderQueue g_render_queue;
+
+AnimationSystem g_animation;
+int g_seamoth_clips[2];
 
 float g_previous_ticks = 0.0f;
 float g_accumulator = 0.0f;
+float g_fixed_timestep = FIXED_TIMESTEP; // --sim-rate trades simulation CPU for coarser steps
 
 float gravity = -0.09f;
 float drag = 0.001f;
@@ -92,154 +250,225 @@ float vertical_acceleration = 0.2f;
 int fuel = 100000;
 int fuel_consumption = 1;
 
+//  STARTUP PROFILE  //
+std::chrono::steady_clock::time_point g_startup_time, g_phase_time;
+bool g_first_frame_presented = false;
+
+//  CLOCK  //
+float get_seconds()
+{
+    if (g_headless) return g_frame_number / g_headless_frame_rate;
+
+    return (float)SDL_GetTicks() / MILLISECONDS_IN_SECOND;
+}
+
+Uint64 get_counter()
+{
+    if (g_headless) return (Uint64)(g_frame_number * (SDL_GetPerformanceFrequency() / g_headless_frame_rate));
+
+    return SDL_GetPerformanceCounter();
+}
+
+void log_startup_phase(const char* phase)
+{
+    typedef std::chrono::duration<float, std::milli> milliseconds;
+    std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+    LOG("Startup: " << phase << " took " << milliseconds(now - g_phase_time).count() << " ms ("
+        << milliseconds(now - g_startup_time).count() << " ms total)");
+    g_phase_time = now;
+}
+
 //  GENERAL FUNCTIONS  //
-GLuint load_texture(const char* filepath)
+void set_entity_texture(Entity* entity, const AtlasRegion &region)
+{
+    entity->set_texture(g_atlas.get_texture_id(region), region.uv_rect);
+}
+
+// Which atlas image each entity draws, recorded while the scene is set up so
+// the atlas knows the largest size every image appears at before it packs
+struct EntityImage
 {
-    int width, height, number_of_components;
-    unsigned char* image = stbi_load(filepath, &width, &height, &number_of_components, STBI_rgb_alpha);
+    Entity* entity;
+    std::string image;
+    int cols, rows; // sprite sheet cells
+};
+
+std::vector<EntityImage> g_entity_images;
+
+void set_entity_image(Entity* entity, const std::string &image, int cols = 1, int rows = 1)
+{
+    EntityImage entity_image = { entity, image, cols, rows };
+    g_entity_images.push_back(entity_image);
+}
 
-    if (image == NULL)
+// The most screen pixels, per axis, that any entity drawing `image` covers.
+// Our camera never zooms, so entity scales are all that matter.
+glm::ivec2 image_footprint(const std::string &image)
+{
+    glm::mat4 camera = g_projection_matrix * g_view_matrix;
+    float pixels_per_unit_x = fabs(camera[0][0]) * VIEWPORT_WIDTH / 2.0f;
+    float pixels_per_unit_y = fabs(camera[1][1]) * VIEWPORT_HEIGHT / 2.0f;
+
+    glm::ivec2 footprint(0);
+
+    for (int i = 0; i < (int)g_entity_images.size(); i++)
     {
-        LOG("Unable to load image. Make sure the path is correct.");
-        assert(false);
+        const EntityImage &entity_image = g_entity_images[i];
+        if (entity_image.image != image) continue;
+
+        glm::vec3 scale = entity_image.entity->get_scale();
+        int cell_width = (int)ceil(fabs(scale.x) * pixels_per_unit_x);
+        int cell_height = (int)ceil(fabs(scale.y) * pixels_per_unit_y);
+
+        footprint.x = std::max(footprint.x, cell_width * entity_image.cols);
+        footprint.y = std::max(footprint.y, cell_height * entity_image.rows);
     }
 
-    GLuint textureID;
-    glGenTextures(NUMBER_OF_TEXTURES, &textureID);
-    glBindTexture(GL_TEXTURE_2D, textureID);
-    glTexImage2D(GL_TEXTURE_2D, LEVEL_OF_DETAIL, GL_RGBA, width, height, TEXTURE_BORDER, GL_RGBA, GL_UNSIGNED_BYTE, image);
+    return footprint;
+}
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+void apply_entity_images()
+{
+    for (int i = 0; i < (int)g_entity_images.size(); i++)
+    {
+        set_entity_texture(g_entity_images[i].entity, g_atlas.get_region(g_entity_images[i].image));
+    }
+}
 
+// The world rectangle an entity's quad covers
+void entity_bounds(const Entity* entity, glm::vec2* min, glm::vec2* max)
+{
+    glm::vec2 centre = glm::vec2(entity->get_position());
+    glm::vec2 half_size = glm::abs(glm::vec2(entity->get_scale())) * 0.5f;
 
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    *min = centre - half_size;
+    *max = centre + half_size;
+}
+
+// Draws the entity unless it lies wholly outside the view
+void render_culled(Entity* entity, RenderSnapshot* snapshot, const glm::vec2 &view_min, const glm::vec2 &view_max)
+{
+    glm::vec2 min, max;
+    entity_bounds(entity, &min, &max);
 
-    stbi_image_free(image);
+    if (max.x < view_min.x || min.x > view_max.x || max.y < view_min.y || min.y > view_max.y)
+    {
+        snapshot->culled++;
+        return;
+    }
 
-    return textureID;
+    entity->render(snapshot);
 }
 
-void draw_text(ShaderProgram* shader_program, GLuint font_texture_id, std::string text,
-    float font_size, float spacing, glm::vec3 position)
-{
-    // Scale the size of the fontbank in the UV-plane
-    // We will use this for spacing and positioning
-    float width = 1.0f / FONTBANK_SIZE;
-    float height = 1.0f / FONTBANK_SIZE;
-
-    // Instead of having a single pair of arrays, we'll have a series of pairsone for
-    // each character. Don't forget to include <vector>!
-    std::vector<float> vertices;
-    std::vector<float> texture_coordinates;
-
-    // For every character...
-    for (int i = 0; i < text.size(); i++) {
-        // 1. Get their index in the spritesheet, as well as their offset (i.e. their
-        //    position relative to the whole sentence)
-        int spritesheet_index = (int)text[i];  // ascii value of character
-        float offset = (font_size + spacing) * i;
-
-        // 2. Using the spritesheet index, we can calculate our U- and V-coordinates
-        float u_coordinate = (float)(spritesheet_index % FONTBANK_SIZE) / FONTBANK_SIZE;
-        float v_coordinate = (float)(spritesheet_index / FONTBANK_SIZE) / FONTBANK_SIZE;
-
-        // 3. Inset the current pair in both vectors
-        vertices.insert(vertices.end(), {
-            offset + (-0.5f * font_size), 0.5f * font_size,
-            offset + (-0.5f * font_size), -0.5f * font_size,
-            offset + (0.5f * font_size), 0.5f * font_size,
-            offset + (0.5f * font_size), -0.5f * font_size,
-            offset + (0.5f * font_size), 0.5f * font_size,
-            offset + (-0.5f * font_size), -0.5f * font_size,
-            });
-
-        texture_coordinates.insert(texture_coordinates.end(), {
-            u_coordinate, v_coordinate,
-            u_coordinate, v_coordinate + height,
-            u_coordinate + width, v_coordinate,
-            u_coordinate + width, v_coordinate + height,
-            u_coordinate + width, v_coordinate,
-            u_coordinate, v_coordinate + height,
-            });
-    }
-
-    // 4. And render all of them using the pairs
-    glm::mat4 model_matrix = glm::mat4(1.0f);
-    model_matrix = glm::translate(model_matrix, position);
-
-    shader_program->set_model_matrix(model_matrix);
-    glUseProgram(shader_program->get_program_id());
-
-    glVertexAttribPointer(shader_program->get_position_attribute(), 2, GL_FLOAT, false, 0,
-        vertices.data());
-    glEnableVertexAttribArray(shader_program->get_position_attribute());
-
-    glVertexAttribPointer(shader_program->get_tex_coordinate_attribute(), 2, GL_FLOAT,
-        false, 0, texture_coordinates.data());
-    glEnableVertexAttribArray(shader_program->get_tex_coordinate_attribute());
-
-    glBindTexture(GL_TEXTURE_2D, font_texture_id);
-    glDrawArrays(GL_TRIANGLES, 0, (int)(text.size() * 6));
-
-    glDisableVertexAttribArray(shader_program->get_position_attribute());
-    glDisableVertexAttribArray(shader_program->get_tex_coordinate_attribute());
+// Every entity remembers where it was before the step that is about to run,
+// so the renderer can draw anywhere in between
+void save_previous_states()
+{
+    g_camera.save_previous_state();
+    g_state.points->save_previous_state();
+    for (int i = 0; i < PLATFORM_COUNT; i++) g_state.platforms[i].save_previous_state();
+    g_state.player->save_previous_state();
 }
 
-GLuint g_font_texture_id;
+SdfFont g_font;
+
+// Retained HUD text; the fuel readout is only rebuilt when the value changes
+TextMesh g_fuel_text;
+TextMesh g_parked_text;
+TextMesh g_crashed_text;
+int g_displayed_fuel = -1;
 
-void initialise()
+bool initialise()
 {
-    SDL_Init(SDL_INIT_VIDEO);
-    g_display_window = SDL_CreateWindow("Safe(?) Shallows Seamoth",
-        SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
-        WINDOW_WIDTH, WINDOW_HEIGHT,
-        SDL_WINDOW_OPENGL);
+    g_startup_time = g_phase_time = std::chrono::steady_clock::now();
+
+    if (g_software)
+    {
+        // Nothing here talks to GL, so there is no context to make
+        SDL_Init(SDL_INIT_EVENTS);
+        gl_set_no_context();
+    }
+    else if (g_headless)
+    {
+        // SDL still supplies timers and (empty) input, just no window
+        SDL_Init(SDL_INIT_EVENTS);
+        if (!g_headless_context.initialise())
+        {
+            SDL_Quit();
+            return false;
+        }
+    }
+    else
+    {
+        SDL_Init(SDL_INIT_VIDEO);
 
-    SDL_GLContext context = SDL_GL_CreateContext(g_display_window);
-    SDL_GL_MakeCurrent(g_display_window, context);
+        // The shaders are GLSL 1.10, so the profile has to keep the old built-ins
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_MAJOR_VERSION, GL_VERSION_REQUIRED / 10);
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_MINOR_VERSION, GL_VERSION_REQUIRED % 10);
+        SDL_GL_SetAttribute(SDL_GL_CONTEXT_PROFILE_MASK, SDL_GL_CONTEXT_PROFILE_COMPATIBILITY);
+
+        g_display_window = SDL_CreateWindow("Safe(?) Shallows Seamoth",
+            SDL_WINDOWPOS_CENTERED, SDL_WINDOWPOS_CENTERED,
+            WINDOW_WIDTH, WINDOW_HEIGHT,
+            SDL_WINDOW_OPENGL);
+
+        g_context = SDL_GL_CreateContext(g_display_window);
+        SDL_GL_MakeCurrent(g_display_window, g_context);
+    }
 
 #ifdef _WINDOWS
-    glewInit();
+    if (!g_software) glewInit();
 #endif
 
-    glViewport(VIEWPORT_X, VIEWPORT_Y, VIEWPORT_WIDTH, VIEWPORT_HEIGHT);
+    if (!g_software && gl_version() < GL_VERSION_REQUIRED)
+    {
+        LOG("OpenGL " << GL_VERSION_REQUIRED / 10 << "." << GL_VERSION_REQUIRED % 10
+            << " (compatibility profile) is required, but the context is "
+            << gl_version() / 10 << "." << gl_version() % 10);
+        g_headless_context.cleanup();
+        SDL_Quit();
+        return false;
+    }
+
+    // Without a window the capture target is the only framebuffer there is
+    if (g_headless && !g_capture.initialise(WINDOW_WIDTH, WINDOW_HEIGHT, g_capture_filepath))
+    {
+        g_headless_context.cleanup();
+        SDL_Quit();
+        return false;
+    }
+    if (g_headless && !g_software) g_capture.bind();
 
-    g_program.load(V_SHADER_PATH, F_SHADER_PATH);
+    if (!g_software) glViewport(VIEWPORT_X, VIEWPORT_Y, VIEWPORT_WIDTH, VIEWPORT_HEIGHT);
+    log_startup_phase("window and GL context");
 
-    g_view_matrix = glm::mat4(1.0f);
-    g_projection_matrix = glm::ortho(-5.0f, 5.0f, -3.75f, 3.75f, -1.0f, 1.0f);
+    //  BACKGROUND  //
+    // Tiles stream into the layers' pages as the camera reaches them. With
+    // the camera at the origin the layers line up into the whole picture.
+    g_background.initialise(glm::vec2(VIEW_HALF_WIDTH, VIEW_HALF_HEIGHT) + glm::vec2(CULL_MARGIN));
 
-    g_program.set_projection_matrix(g_projection_matrix);
-    g_program.set_view_matrix(g_view_matrix);
+    ParallaxLayer far_layer;
+    far_layer.filepath = BACKGROUND_FILEPATH;
+    far_layer.image_size = glm::vec2(10.0f, 10.0f);
+    far_layer.scroll = BACKGROUND_FAR_SCROLL;
 
-    glUseProgram(g_program.get_program_id());
+    ParallaxLayer floor_layer = far_layer;
+    floor_layer.band_top = BACKGROUND_FLOOR_ROW;
+    floor_layer.fade_rows = BACKGROUND_FLOOR_FADE_ROWS;
+    floor_layer.scroll = BACKGROUND_FLOOR_SCROLL;
 
-    glClearColor(BG_RED, BG_BLUE, BG_GREEN, BG_OPACITY);
-    //  BACKGROUND  //
-    GLuint background_texture_id = load_texture(BACKGROUND_FILEPATH);
-    GLuint points_id = load_texture(POINTS_FILEPATH);
-    g_font_texture_id = load_texture(FONT_FILEPATH);
-    
-    g_state.background = new Entity();
-    g_state.background->set_position(glm::vec3(0.0f));
-    g_state.background->m_texture_id = background_texture_id;
-    g_state.background->set_scale(glm::vec3(10.0f, 10.0f, 0.0f));
-    g_state.background->update(0.0f, NULL, 0);
+    if (!g_background.add_layer(far_layer) || !g_background.add_layer(floor_layer)) return false;
 
     g_state.points = new Entity();
     g_state.points->set_position(glm::vec3(0.0f));
-    g_state.points->m_texture_id = points_id;
+    set_entity_image(g_state.points, "points");
     g_state.points->set_scale(glm::vec3(10.0f, 10.0f, 0.0f));
     g_state.points->update(0.0f, NULL, 0);
 
 
     
     //  PLATFORMS  //
-    GLuint platform_texture_id = load_texture(PLATFORM_FILEPATH);
-    GLuint danger_texture_id = load_texture(DANGER_FILEPATH);
-    GLuint reaper_texture_id = load_texture(REAPER_FILEPATH);
 
 
     g_state.platforms = new Entity[PLATFORM_COUNT];
@@ -250,18 +479,18 @@ void initialise()
 
     for (int i = 5; i < PLATFORM_COUNT; i++) {
         g_state.platforms[i].object_loses();
-        if (i >5) g_state.platforms[i].m_texture_id = danger_texture_id;
+        if (i >5) set_entity_image(&g_state.platforms[i], "danger");
     }
 
     //x1 point platform
-    g_state.platforms[0].m_texture_id = platform_texture_id;
+    set_entity_image(&g_state.platforms[0], "platform");
     g_state.platforms[0].set_position(glm::vec3(-4.0f, -0.9f, 0.0f));
     g_state.platforms[0].set_dimensions(glm::vec3(0.8f, 1.0f, 0.0f));
     g_state.platforms[0].update(0.0f, NULL, 0);
 
     
     //x2 point platform
-    g_state.platforms[1].m_texture_id = platform_texture_id;
+    set_entity_image(&g_state.platforms[1], "platform");
     g_state.platforms[1].set_position(glm::vec3(-0.5f, 0.6f, 0.0f));
     g_state.platforms[1].set_dimensions(glm::vec3(0.6f, 1.0f, 0.0f));
     g_state.platforms[1].update(0.0f, NULL, 0);
@@ -269,25 +498,25 @@ void initialise()
     
 
     //x3 point platform
-    g_state.platforms[2].m_texture_id = platform_texture_id;
+    set_entity_image(&g_state.platforms[2], "platform");
     g_state.platforms[2].set_position(glm::vec3(0.9f, -0.8f, 0.0f));
     g_state.platforms[2].set_dimensions(glm::vec3(0.7f, 1.0f, 0.0f));
     g_state.platforms[2].update(0.0f, NULL, 0);
     
     //x5 point platform
-    g_state.platforms[4].m_texture_id = platform_texture_id;
+    set_entity_image(&g_state.platforms[4], "platform");
     g_state.platforms[4].set_position(glm::vec3(2.1f, -2.5f, 0.0f));
     g_state.platforms[4].set_dimensions(glm::vec3(0.5f, 1.0f, 0.0f));
     g_state.platforms[4].update(0.0f, NULL, 0);
 
     //x4 point platform
-    g_state.platforms[3].m_texture_id = platform_texture_id;
+    set_entity_image(&g_state.platforms[3], "platform");
     g_state.platforms[3].set_position(glm::vec3(-1.7f, -1.0f, 0.0f));
     g_state.platforms[3].set_dimensions(glm::vec3(0.8f, 1.0f, 0.0f));
     g_state.platforms[3].update(0.0f, NULL, 0);
 
     //Reaper Leviathan
-    g_state.platforms[5].m_texture_id = reaper_texture_id;
+    set_entity_image(&g_state.platforms[5], "reaper");
     g_state.platforms[5].set_position(glm::vec3(3.0f, 2.0f, 0.0f));
     g_state.platforms[5].set_dimensions(glm::vec3(1.5f, 1.0f, 0.0f));
 
@@ -343,32 +572,167 @@ void initialise()
     g_state.player->set_dimensions(glm::vec3(0.6f, 0.8f, 0.0f));
     g_state.player->m_speed = 1.0f;
     g_state.player->set_acceleration(glm::vec3(0.0f, gravity, 0.0f));
-    g_state.player->m_texture_id = load_texture(SPRITESHEET_FILEPATH);
+    set_entity_image(g_state.player, "seamoth", SEAMOTH_SHEET_COLS, SEAMOTH_SHEET_ROWS);
 
     // Walking
-    g_state.player->m_walking[g_state.player->LEFT] = new int[4] { 0 };
-    g_state.player->m_walking[g_state.player->RIGHT] = new int[4] { 1 };
+    g_seamoth_clips[Entity::LEFT] = g_animation.add_clip({ 0 }, SEAMOTH_SECONDS_PER_FRAME, LOOP_REPEAT,
+        SEAMOTH_SHEET_COLS, SEAMOTH_SHEET_ROWS);
+    g_seamoth_clips[Entity::RIGHT] = g_animation.add_clip({ 1 }, SEAMOTH_SECONDS_PER_FRAME, LOOP_REPEAT,
+        SEAMOTH_SHEET_COLS, SEAMOTH_SHEET_ROWS);
 
-    g_state.player->m_animation_indices = g_state.player->m_walking[g_state.player->LEFT];  // start George looking left
-    g_state.player->m_animation_frames = 1;
-    g_state.player->m_animation_index = 0;
-    g_state.player->m_animation_time = 0.0f;
-    g_state.player->m_animation_cols = 2;
-    g_state.player->m_animation_rows = 1;
+    g_state.player->m_animation = &g_animation;
+    g_state.player->m_animator = g_animation.create_animator(g_seamoth_clips[Entity::LEFT]);  // start George looking left
 
     // Jumping
     g_state.player->m_jumping_power = 3.0f;
 
-    
+    g_particles.initialise(g_particle_stress > 0 ? g_particle_stress : MAX_PARTICLES);
+    g_particles.set_drag(WATER_DRAG);
+
+    //  CAMERA  //
+    g_camera.initialise(glm::vec2(VIEW_HALF_WIDTH, VIEW_HALF_HEIGHT), LEVEL_MIN, LEVEL_MAX);
+    g_camera.look_at(glm::vec2(g_state.player->get_position()));
+
+    g_scenery.push_back(g_state.points);
+    for (int i = 6; i < PLATFORM_COUNT; i++) g_scenery.push_back(&g_state.platforms[i]);
+
+    g_scenery_grid.initialise(LEVEL_MIN, LEVEL_MAX, CULL_CELL_SIZE);
+    for (int i = 0; i < (int)g_scenery.size(); i++)
+    {
+        glm::vec2 min, max;
+        entity_bounds(g_scenery[i], &min, &max);
+        g_scenery_grid.insert(i, min, max);
+    }
+
+    log_startup_phase("scene setup");
+
+    //  ASSETS  //
+    // Decoding, packing and the distance field all run on worker threads
+    // while this one gets the shaders going. Every sprite shares one or two
+    // atlas pages, so the batch rarely has to switch textures; the packed
+    // pages are cached next to the assets. No image is kept larger than the
+    // most screen pixels any entity covers with it, so the scene is set up
+    // first and the camera fixed before anything is added.
+    g_view_matrix = glm::mat4(1.0f);
+    g_projection_matrix = glm::ortho(-VIEW_HALF_WIDTH, VIEW_HALF_WIDTH, -VIEW_HALF_HEIGHT, VIEW_HALF_HEIGHT, -1.0f, 1.0f);
+
+    g_atlas.add_image("points", POINTS_FILEPATH, image_footprint("points"));
+    g_atlas.add_image("platform", PLATFORM_FILEPATH, image_footprint("platform"));
+    g_atlas.add_image("danger", DANGER_FILEPATH, image_footprint("danger"));
+    g_atlas.add_image("reaper", REAPER_FILEPATH, image_footprint("reaper"));
+    g_atlas.add_image("seamoth", SPRITESHEET_FILEPATH, image_footprint("seamoth"));
+    g_atlas.set_keep_pixels(g_software);
+    g_atlas.start_build(ATLAS_CACHE_FILEPATH);
+
+    // HUD text at any size comes from one small distance-field texture
+    g_font.set_keep_texels(g_software);
+    g_font.start_generate(FONT_FILEPATH, FONTBANK_SIZE);
+
+    // Instancing needs GL 3.3 or ARB_instanced_arrays; without it the sprite
+    // batch falls back to expanding every quad on the CPU
+    bool use_instancing = gl_version() >= 33 || gl_has_extension("GL_ARB_instanced_arrays");
+    int instancing = use_instancing ? SHADER_INSTANCED : 0;
+
+    // The masks still sort the render queue when nothing is compiled
+    g_sprite_shader = SHADER_TEXTURED | SHADER_TINTED | instancing;
+    g_text_shader = SHADER_SDF_TEXT | SHADER_TINTED | instancing;
+    // With instancing, particles go to the GPU in their own layout, straight
+    // from the snapshot; otherwise they are sprites like any other
+    g_particle_shader = use_instancing ? SHADER_PARTICLE | SHADER_TINTED : SHADER_TINTED;
+
+    if (!g_software)
+    {
+        // Every variant comes from the one sprite source. Ours start compiling
+        // now, in the driver's threads where it has them, and are only waited
+        // for at the first draw.
+        g_shaders.load(V_SHADER_PATH, F_SHADER_PATH);
+        g_shaders.precompile(g_sprite_shader);
+        g_shaders.precompile(g_text_shader);
+        g_shaders.precompile(g_particle_shader);
+
+        g_shaders.set_projection_matrix(g_projection_matrix);
+        g_shaders.set_view_matrix(g_view_matrix);
+
+        g_batch.initialise();
+        if (g_particle_shader & SHADER_PARTICLE) g_particle_renderer.initialise(g_particles.get_capacity());
+        g_static_layer.initialise();
+
+        glClearColor(BG_RED, BG_BLUE, BG_GREEN, BG_OPACITY);
+    }
+
+    if (g_render_job_threads <= 0) g_render_job_threads = std::max((int)std::thread::hardware_concurrency(), 1);
+    g_render_jobs.initialise(g_render_job_threads - 1);
+    g_profiler.initialise();
+    log_startup_phase("shader compiles issued, GL setup");
+
+    g_atlas.finish_build();
+    log_startup_phase("texture atlas (decode, pack or cache, upload)");
+
+    g_font.finish_generate();
+    log_startup_phase("SDF font");
+
+    // The rasteriser finds its copies of the textures by their GL names
+    if (g_software)
+    {
+        g_rasteriser.initialise(WINDOW_WIDTH, WINDOW_HEIGHT);
+        g_rasteriser.set_clear_colour(BG_RED, BG_BLUE, BG_GREEN, BG_OPACITY);
+        g_rasteriser.set_matrix(g_projection_matrix * g_view_matrix);
+
+        for (int page = 0; page < g_atlas.get_page_count(); page++)
+        {
+            GLuint texture_id = g_atlas.get_texture_id(page);
+            int width = g_atlas.get_page_width(page), height = g_atlas.get_page_height(page);
+            g_rasteriser.add_texture(texture_id, width, height, g_atlas.get_page_pixels(page).data());
+
+            // Filtered as TextureAtlas::upload sets the GL texture up
+            const std::vector<std::vector<unsigned char> > &mips = g_atlas.get_page_mips(page);
+            for (int level = 1; level <= (int)mips.size(); level++)
+            {
+                g_rasteriser.add_mip_level(texture_id, std::max(width >> level, 1), std::max(height >> level, 1),
+                    mips[level - 1].data());
+            }
+            g_rasteriser.set_filters(texture_id, GL_LINEAR_MIPMAP_LINEAR, GL_NEAREST);
+        }
+        g_rasteriser.add_luminance_alpha_texture(g_font.get_texture_id(), g_font.get_texture_size(),
+            g_font.get_texture_size(), g_font.get_texels().data());
+
+        LOG("Software rasteriser: " << g_rasteriser.get_worker_count() + 1 << " threads");
+        log_startup_phase("software rasteriser");
+    }
+
+    apply_entity_images();
+
+    g_fuel_text.initialise(g_font.get_texture_id(), g_font.get_region(), FONTBANK_SIZE, 0.5f, 0.005f,
+        glm::vec3(-4.5f, 3.5f, 0.0f));
+    g_parked_text.initialise(g_font.get_texture_id(), g_font.get_region(), FONTBANK_SIZE, 0.5f, 0.005f,
+        glm::vec3(-3.5f, 1.5f, 0.0f));
+    g_crashed_text.initialise(g_font.get_texture_id(), g_font.get_region(), FONTBANK_SIZE, 0.5f, 0.005f,
+        glm::vec3(-3.5f, 1.5f, 0.0f));
+    for (int i = 0; i < PROFILE_SECTION_COUNT; i++)
+    {
+        g_profiler_text[i].initialise(g_font.get_texture_id(), g_font.get_region(), FONTBANK_SIZE, 0.3f, -0.15f,
+            glm::vec3(-4.7f, 3.0f - 0.25f * i, 0.0f));
+    }
+    g_parked_text.set_text("Seamoth Parked");
+    g_crashed_text.set_text("Seamoth Crashed");
 
     //  GENERAL  //
-    glEnable(GL_BLEND);
-    glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    if (!g_software)
+    {
+        glEnable(GL_BLEND);
+        glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+    }
+
+    save_previous_states();
+    log_startup_phase("textures and HUD text");
+
+    return true;
 }
 
 void process_input()
 {
     g_state.player->set_movement(glm::vec3(0.0f));
+    g_thrust = glm::vec2(0.0f);
 
     SDL_Event event;
     while (SDL_PollEvent(&event))
@@ -386,6 +750,9 @@ void process_input()
                 // Quit the game with a keystroke
                 g_game_is_running = false;
                 break;
+            case SDLK_F3:
+                g_show_profiler = !g_show_profiler;
+                break;
             default:
                 break;
             }
@@ -397,24 +764,35 @@ void process_input()
 
     const Uint8* key_state = SDL_GetKeyboardState(NULL);
 
+    int keys = 0;
+    if (key_state[SDL_SCANCODE_LEFT])  keys |= INPUT_LEFT;
+    if (key_state[SDL_SCANCODE_RIGHT]) keys |= INPUT_RIGHT;
+    if (key_state[SDL_SCANCODE_UP])    keys |= INPUT_UP;
+
+    if (g_playing_replay) keys = g_replay.get_keys(g_frame_number);
+    else if (g_record_filepath != NULL) g_replay.record(g_frame_number, keys);
+
     if (!g_state.player->has_object_lost() && !g_state.player->has_object_won()) {
 
 
-        if (key_state[SDL_SCANCODE_LEFT] && fuel > 0)
+        if ((keys & INPUT_LEFT) && fuel > 0)
         {
             g_state.player->player_accelerate_left(acceleration_rate,horizontal_acceleration);
-            g_state.player->m_animation_indices = g_state.player->m_walking[g_state.player->LEFT];
+            g_thrust = glm::vec2(-1.0f, 0.0f);
+            g_animation.play(g_state.player->m_animator, g_seamoth_clips[Entity::LEFT]);
             fuel -= fuel_consumption;
         }
-        else if (key_state[SDL_SCANCODE_RIGHT] && fuel > 0)
+        else if ((keys & INPUT_RIGHT) && fuel > 0)
         {
             g_state.player->player_accelerate_right(acceleration_rate, horizontal_acceleration);
-            g_state.player->m_animation_indices = g_state.player->m_walking[g_state.player->RIGHT];
+            g_thrust = glm::vec2(1.0f, 0.0f);
+            g_animation.play(g_state.player->m_animator, g_seamoth_clips[Entity::RIGHT]);
             fuel -= fuel_consumption;
         }
-        else if (key_state[SDL_SCANCODE_UP] && fuel > 0)
+        else if ((keys & INPUT_UP) && fuel > 0)
         {
             g_state.player->set_acceleration_y(vertical_acceleration);
+            g_thrust = glm::vec2(0.0f, 1.0f);
             fuel -= fuel_consumption;
         }
         else if (g_state.player->get_acceleration().x != 0) {
@@ -434,90 +812,691 @@ void process_input()
 float ANGLE = 0.0f;
 glm::vec3 reaper_movement;
 
-void update()
+// Bubbles leave the thruster opposite the push and drift back up
+void emit_bubbles(float delta_time)
+{
+    g_bubbles_owed += BUBBLES_PER_SECOND * delta_time;
+    int count = (int)g_bubbles_owed;
+    g_bubbles_owed -= count;
+
+    ParticleEmitter bubbles;
+    bubbles.position = glm::vec2(g_state.player->get_position()) - g_thrust * 0.3f;
+    bubbles.position_spread = glm::vec2(0.05f);
+    bubbles.velocity = -g_thrust * 0.8f;
+    bubbles.velocity_spread = glm::vec2(0.2f);
+    bubbles.acceleration_y = 0.6f;
+    bubbles.lifetime = 1.2f;
+    bubbles.lifetime_spread = 0.4f;
+    bubbles.size = 0.06f;
+    bubbles.size_spread = 0.03f;
+    bubbles.colour = glm::vec4(0.85f, 0.95f, 1.0f, 0.7f);
+
+    g_particles.emit(bubbles, count);
+}
+
+void emit_wreckage()
+{
+    ParticleEmitter wreckage;
+    wreckage.position = glm::vec2(g_state.player->get_position());
+    wreckage.position_spread = glm::vec2(0.2f, 0.15f);
+    wreckage.velocity = glm::vec2(0.0f, 0.8f);
+    wreckage.velocity_spread = glm::vec2(1.5f, 1.0f);
+    wreckage.acceleration_y = -1.5f;
+    wreckage.lifetime = 2.5f;
+    wreckage.lifetime_spread = 1.0f;
+    wreckage.size = 0.07f;
+    wreckage.size_spread = 0.04f;
+    wreckage.colour = glm::vec4(0.35f, 0.33f, 0.3f, 1.0f);
+
+    g_particles.emit(wreckage, WRECKAGE_PARTICLES);
+}
+
+// Refills the pool with particles anywhere in view, for --particle-stress
+void emit_stress_particles()
 {
-    float ticks = (float)SDL_GetTicks() / MILLISECONDS_IN_SECOND;
+    ParticleEmitter stress;
+    stress.position = g_camera.get_position();
+    stress.position_spread = g_camera.get_half_size();
+    stress.velocity_spread = glm::vec2(0.5f);
+    stress.acceleration_y = 0.2f;
+    stress.lifetime = 2.0f;
+    stress.lifetime_spread = 1.0f;
+    stress.size = 0.02f;
+    stress.size_spread = 0.01f;
+    stress.colour = glm::vec4(0.85f, 0.95f, 1.0f, 0.5f);
+
+    g_particles.emit(stress, g_particles.get_capacity() - g_particles.get_count());
+}
+
+// Returns whether the simulation advanced at all
+bool update()
+{
+    float ticks = get_seconds();
     float delta_time = ticks - g_previous_ticks;
     g_previous_ticks = ticks;
 
     delta_time += g_accumulator;
 
-    if (delta_time < FIXED_TIMESTEP)
+    if (delta_time < g_fixed_timestep)
     {
         g_accumulator = delta_time;
-        return;
+        return false;
     }
 
 
-    while (delta_time >= FIXED_TIMESTEP && !g_state.player->has_object_won() && !g_state.player->has_object_lost())
+    while (delta_time >= g_fixed_timestep)
     {
+        // Saved even once the game is over, so finished entities stop
+        // interpolating instead of wobbling between their last two steps
+        save_previous_states();
+
+        delta_time -= g_fixed_timestep;
+
+        // Wreckage keeps falling after the game is over
+        g_particles.update(g_fixed_timestep);
+        if (g_particle_stress > 0) emit_stress_particles();
+
+        if (g_state.player->has_object_won() || g_state.player->has_object_lost()) continue;
+
         //Reaper movement
-        g_state.platforms[5].update(FIXED_TIMESTEP, NULL, 0);
+        g_state.platforms[5].update(g_fixed_timestep, NULL, 0);
         g_state.platforms[5].set_position(glm::vec3(cos(ANGLE/2.0f) + 3.0f, sin(ANGLE) + 2.0f, 0.0f));
-        ANGLE += 1.0f * FIXED_TIMESTEP;
+        ANGLE += 1.0f * g_fixed_timestep;
 
-        g_state.player->update(FIXED_TIMESTEP, g_state.platforms, PLATFORM_COUNT);
-        if (g_state.player->get_position().x < -4.8 || g_state.player->get_position().x > 4.8) {
+        g_state.player->update(g_fixed_timestep, g_state.platforms, PLATFORM_COUNT);
+        if (g_state.player->get_position().x < LEVEL_MIN.x + 0.2f || g_state.player->get_position().x > LEVEL_MAX.x - 0.2f) {
             g_state.player->object_loses();
         }
-        
 
-        delta_time -= FIXED_TIMESTEP;
+        // Later steps stop at the check above, so this is the crash itself
+        if (g_state.player->has_object_lost()) emit_wreckage();
+        else if (g_thrust != glm::vec2(0.0f)) emit_bubbles(g_fixed_timestep);
+
+        g_camera.follow(glm::vec2(g_state.player->get_position()), g_fixed_timestep);
+
+        // Every animator advances in one batched pass after the entities
+        // have decided whether they are moving
+        g_animation.advance(g_fixed_timestep);
     }
 
     g_accumulator = delta_time;
 
-   
+    return true;
 }
 
 float TIMER = 0;
 
-void render()
+// Lays n copies of the points sign over the view, each bobbing on its own
+// phase, for --sprite-stress
+void add_stress_sprites(RenderSnapshot* snapshot)
 {
-    glClear(GL_COLOR_BUFFER_BIT);
+    const AtlasRegion &region = g_atlas.get_region("points");
+    GLuint texture_id = g_atlas.get_texture_id(region);
+    glm::vec2 half_view = g_camera.get_half_size();
 
-    g_state.background->render(&g_program);
+    int columns = (int)ceil(sqrt((float)g_sprite_stress));
+    int rows = (g_sprite_stress + columns - 1) / columns;
+    glm::vec2 cell = 2.0f * half_view / glm::vec2((float)columns, (float)rows);
 
-    //Reaper
-    g_state.platforms[5].render(&g_program);
+    for (int i = 0; i < g_sprite_stress; i++)
+    {
+        glm::vec2 offset = -half_view + cell * (glm::vec2((float)(i % columns), (float)(i / columns)) + 0.5f);
+
+        glm::mat4 previous_model_matrix = glm::mat4(1.0f), model_matrix = glm::mat4(1.0f);
+        previous_model_matrix[0][0] = model_matrix[0][0] = cell.x;
+        previous_model_matrix[1][1] = model_matrix[1][1] = cell.y;
+        previous_model_matrix[3] = glm::vec4(snapshot->previous_camera + offset, 0.0f, 1.0f);
+        model_matrix[3] = glm::vec4(snapshot->camera + offset, 0.0f, 1.0f);
+        previous_model_matrix[3].y += 0.25f * cell.y * sinf(0.1f * (TIMER - 1) + i);
+        model_matrix[3].y += 0.25f * cell.y * sinf(0.1f * TIMER + i);
+
+        snapshot->add_sprite(texture_id, previous_model_matrix, model_matrix, region.uv_rect, glm::vec4(1.0f));
+    }
+}
+
+// Runs on the simulation thread and touches no GL at all
+void build_snapshot(RenderSnapshot* snapshot)
+{
+    snapshot->clear();
+    snapshot->camera = g_camera.get_position();
+    snapshot->previous_camera = g_camera.get_previous_position();
+
+    // Whatever the renderer interpolates to lies between the view at the
+    // start of the step and the view at its end
+    glm::vec2 half_view = g_camera.get_half_size() + glm::vec2(CULL_MARGIN);
+    glm::vec2 view_min = glm::min(snapshot->camera, snapshot->previous_camera) - half_view;
+    glm::vec2 view_max = glm::max(snapshot->camera, snapshot->previous_camera) + half_view;
+
+    // Nothing under LAYER_ACTORS moves but with the camera, so the renderer
+    // can keep it as a picture while the camera is still. The reaper used to
+    // sit between the background and the signs; it never reaches them, and
+    // now swims over the static layer instead.
+    snapshot->shader = g_sprite_shader;
+    g_background.build(snapshot);
+    snapshot->layer = LAYER_SCENERY;
 
     //Makes danger signs and point values blink
     if (10000 - TIMER >= 5000 || g_state.player->has_object_lost() || g_state.player->has_object_won()) {
-        g_state.points->render(&g_program);
+        g_visible_scenery.clear();
+        g_scenery_grid.query(view_min, view_max, g_visible_scenery);
+        snapshot->culled += (int)(g_scenery.size() - g_visible_scenery.size());
 
-        for (int i = 6; i < PLATFORM_COUNT; i++) g_state.platforms[i].render(&g_program);
+        for (int i = 0; i < (int)g_visible_scenery.size(); i++)
+        {
+            render_culled(g_scenery[g_visible_scenery[i]], snapshot, view_min, view_max);
+        }
     }
     else if (10000 - TIMER == 0) {
         TIMER = 0;
     }
     TIMER += 1;
-    
 
-    g_state.player->render(&g_program);
+    // Actors overlap each other, so they keep the order they are added in
+    snapshot->layer = LAYER_ACTORS;
+    snapshot->ordered = true;
+
+    //Reaper
+    render_culled(&g_state.platforms[5], snapshot, view_min, view_max);
     
 
-    std::string fuel_ui = "Fuel: ";
-    std::string fuel_string = std::to_string(fuel);
-    fuel_ui += fuel_string;
+    render_culled(g_state.player, snapshot, view_min, view_max);
 
-    draw_text(&g_program, g_font_texture_id, fuel_ui, 0.5f, 0.005f,
-        glm::vec3(-4.5f, 3.5f, 0.0f));
+    if (g_sprite_stress > 0) add_stress_sprites(snapshot);
+    g_particles.write_frame(&snapshot->particles);
+    
+
+    snapshot->fuel = fuel;
+    snapshot->accumulator = g_accumulator;
+    snapshot->show_profiler = g_show_profiler;
+    for (int i = 0; i < PROFILE_RENDER; i++) snapshot->simulation_milliseconds[i] = g_simulation_milliseconds[i];
+    snapshot->published_at = get_counter();
 
     if (g_state.player->has_object_won()) {
-        draw_text(&g_program, g_font_texture_id, "Seamoth Parked", 0.5f, 0.005f,
-            glm::vec3(-3.5f, 1.5f, 0.0f));
+        snapshot->message = HUD_MESSAGE_PARKED;
     }
     else if (g_state.player->has_object_lost()) {
-        draw_text(&g_program, g_font_texture_id, "Seamoth Crashed", 0.5f, 0.005f,
-            glm::vec3(-3.5f, 1.5f, 0.0f));
+        snapshot->message = HUD_MESSAGE_CRASHED;
+    }
+}
+
+void publish_snapshot()
+{
+    ScopedTimer timer(&g_simulation_milliseconds[PROFILE_SNAPSHOT]);
+
+    build_snapshot(&g_snapshots.get_write_slot());
+    g_snapshots.publish();
+}
+
+// One line per section: name, average and a bar as long as the time
+void update_profiler_overlay()
+{
+    for (int i = 0; i < PROFILE_SECTION_COUNT; i++)
+    {
+        float milliseconds = g_profiler.get_average(i, PROFILER_REFRESH_FRAMES);
+
+        int bars = (int)(milliseconds / PROFILER_MILLISECONDS_PER_BAR + 0.5f);
+        if (bars > PROFILER_MAX_BARS) bars = PROFILER_MAX_BARS;
+
+        char line[64];
+        snprintf(line, sizeof(line), "%-9s %6.3f ms ", profile_section_name(i), milliseconds);
+
+        if (i >= PROFILE_GPU_SCENE && (!g_profiler.is_gpu_supported() || g_software))
+        {
+            snprintf(line, sizeof(line), "%-9s  n/a", profile_section_name(i));
+        }
+
+        g_profiler_text[i].set_text(line + std::string(bars, '|'));
+    }
+}
+
+// Particles are untextured quads in their own colour. The snapshot has their
+// velocities rather than their last positions, so they are wound back along
+// them to where they were `alpha` of the way through the step.
+SpriteInstance particle_instance(const ParticleFrame &particles, int i, float alpha)
+{
+    float rewind = (1.0f - alpha) * g_fixed_timestep;
+    float size = particles.size[i];
+    unsigned int colour = particles.colour[i];
+
+    SpriteInstance instance;
+    instance.position[0] = particles.x[i] - particles.velocity_x[i] * rewind;
+    instance.position[1] = particles.y[i] - particles.velocity_y[i] * rewind;
+    instance.basis[0] = size;
+    instance.basis[1] = 0.0f;
+    instance.basis[2] = 0.0f;
+    instance.basis[3] = size;
+    for (int c = 0; c < 4; c++)
+    {
+        instance.uv_rect[c] = 0.0f;
+        instance.tint[c] = (float)((colour >> (8 * c)) & 255) * (1.0f / 255.0f);
+    }
+    instance.tint[3] *= particles.alpha[i];
+
+    return instance;
+}
+
+const int MAX_HUD_TEXTS = 2 + PROFILE_SECTION_COUNT;
+
+// Brings the HUD text up to date with the snapshot and lists what to draw
+int gather_hud_text(const RenderSnapshot &snapshot, const TextMesh** texts)
+{
+    int count = 0;
+
+    if (snapshot.fuel != g_displayed_fuel) {
+        g_fuel_text.set_text("Fuel: " + std::to_string(snapshot.fuel));
+        g_displayed_fuel = snapshot.fuel;
+    }
+
+    texts[count++] = &g_fuel_text;
+
+    if (snapshot.message == HUD_MESSAGE_PARKED) {
+        texts[count++] = &g_parked_text;
+    }
+    else if (snapshot.message == HUD_MESSAGE_CRASHED) {
+        texts[count++] = &g_crashed_text;
+    }
+
+    if (snapshot.show_profiler)
+    {
+        if (g_profiler.get_frame_count() % PROFILER_REFRESH_FRAMES == 1) update_profiler_overlay();
+
+        for (int i = 0; i < PROFILE_SECTION_COUNT; i++) texts[count++] = &g_profiler_text[i];
+    }
+
+    return count;
+}
+
+//  RENDER COMMANDS  //
+
+// Fills the render queue with everything the frame draws and sorts it into
+// draw order. Sprite commands index the snapshot's sprites; text commands
+// index `hud_text`.
+void queue_commands(const RenderSnapshot &snapshot, const TextMesh** hud_text, int hud_text_count)
+{
+    g_render_queue.clear();
+
+    for (int i = 0; i < (int)snapshot.sprites.size(); i++)
+    {
+        g_render_queue.submit(snapshot.sprites[i].key, COMMAND_SPRITE, i);
+    }
+
+    if (snapshot.particles.count > 0)
+    {
+        g_render_queue.submit(make_render_key(LAYER_PARTICLES, g_particle_shader, SoftwareRasteriser::UNTEXTURED),
+                              COMMAND_PARTICLES, 0);
+    }
+
+    for (int i = 0; i < hud_text_count; i++)
+    {
+        g_render_queue.submit(make_render_key(LAYER_HUD, g_text_shader, hud_text[i]->get_texture_id()),
+                              COMMAND_TEXT, i);
+    }
+
+    g_render_queue.sort();
+    g_total_render_commands += g_render_queue.get_count();
+}
+
+// Draws a run of sprite commands that share a program. Their instances (or
+// vertices) are written by the render jobs, each into its own slice of one
+// reservation in the batch's buffer, and then drawn from this thread in one
+// call per texture (or per batch's worth, if a texture has more).
+void execute_sprite_commands(int first, int last, const RenderSnapshot &snapshot, float alpha, bool interpolated,
+                             GLuint* current_texture)
+{
+    int count = last - first;
+    void* slots = g_batch.reserve_sprites(count);
+
+    // Only the generation itself; the reservation may wait on the GPU
+    Uint64 generate_start = SDL_GetPerformanceCounter();
+    int job_count = std::min(g_render_jobs.get_thread_count(), (count + MIN_SPRITES_PER_JOB - 1) / MIN_SPRITES_PER_JOB);
+    g_render_jobs.run(job_count, [&](int job) {
+        int job_first = first + (int)((long long)count * job / job_count);
+        int job_last = first + (int)((long long)count * (job + 1) / job_count);
+
+        for (int c = job_first; c < job_last; c++)
+        {
+            const SnapshotSprite &sprite = snapshot.sprites[g_render_queue.get_command(c).index];
+            g_batch.write_sprite(slots, c - first, interpolated ? sprite.interpolate(alpha) : sprite.instance);
+        }
+    });
+
+    g_total_generate_milliseconds += milliseconds_since(generate_start);
+
+    // The queue is sorted, so sprites that share a texture are already together
+    int run_first = first;
+    for (int c = first; c < last; c++)
+    {
+        GLuint texture = render_key_texture(g_render_queue.get_command(c).key);
+        if (texture != *current_texture)
+        {
+            if (c > run_first) g_batch.draw_reserved(*current_texture, c - run_first);
+            run_first = c;
+            *current_texture = texture;
+            g_total_texture_changes++;
+        }
+    }
+    g_batch.draw_reserved(*current_texture, last - run_first);
+}
+
+// Draws commands [first, last) of the sorted queue into the batch, changing
+// program only where the key's shader does. Sprites are drawn where they
+// were at the end of their step unless `interpolated`. Returns the particle
+// draw calls and vertices that went around the batch.
+void execute_commands(int first, int last, const RenderSnapshot &snapshot, const TextMesh** hud_text,
+                      float alpha, bool interpolated, int* particle_draw_calls, int* particle_vertices)
+{
+    int current_shader = -1;
+    GLuint current_texture = 0;
+
+    for (int c = first; c < last; c++)
+    {
+        const RenderCommand &command = g_render_queue.get_command(c);
+
+        int shader = render_key_shader(command.key);
+        if (shader != current_shader)
+        {
+            g_batch.begin(g_shaders.get(shader));
+            current_shader = shader;
+            g_total_program_changes++;
+        }
+
+        if (command.kind == COMMAND_SPRITE)
+        {
+            // Everything up to the next program change, in one reservation and
+            // one round of jobs however many sprites that is
+            int span_last = c + 1;
+            while (span_last < last &&
+                   g_render_queue.get_command(span_last).kind == COMMAND_SPRITE &&
+                   render_key_shader(g_render_queue.get_command(span_last).key) == shader)
+            {
+                span_last++;
+            }
+
+            execute_sprite_commands(c, span_last, snapshot, alpha, interpolated, &current_texture);
+            c = span_last - 1;
+            continue;
+        }
+
+        GLuint texture = render_key_texture(command.key);
+        if (texture != current_texture)
+        {
+            current_texture = texture;
+            g_total_texture_changes++;
+        }
+
+        if (command.kind == COMMAND_PARTICLES)
+        {
+            if (shader & SHADER_PARTICLE)
+            {
+                g_batch.flush();
+                int drawn = g_particle_renderer.draw(g_shaders.get(shader), snapshot.particles, (1.0f - alpha) * g_fixed_timestep);
+                *particle_draw_calls += 1;
+                *particle_vertices += drawn * 4;
+            }
+            else
+            {
+                for (int i = 0; i < snapshot.particles.count; i++)
+                {
+                    g_batch.draw_instance(SoftwareRasteriser::UNTEXTURED, particle_instance(snapshot.particles, i, alpha));
+                }
+            }
+        }
+        else if (command.kind == COMMAND_TEXT)
+        {
+            hud_text[command.index]->render(&g_batch);
+        }
+    }
+}
+
+// The software renderer walks the same commands; it has no programs to change
+void execute_commands_software(int first, int last, const RenderSnapshot &snapshot, const TextMesh** hud_text, float alpha)
+{
+    for (int c = first; c < last; c++)
+    {
+        const RenderCommand &command = g_render_queue.get_command(c);
+
+        if (command.kind == COMMAND_SPRITE)
+        {
+            const SnapshotSprite &sprite = snapshot.sprites[command.index];
+            g_rasteriser.draw_sprite(sprite.get_texture_id(), sprite.interpolate(alpha));
+        }
+        else if (command.kind == COMMAND_PARTICLES)
+        {
+            for (int i = 0; i < snapshot.particles.count; i++)
+            {
+                g_rasteriser.draw_sprite(SoftwareRasteriser::UNTEXTURED, particle_instance(snapshot.particles, i, alpha));
+            }
+        }
+        else if (command.kind == COMMAND_TEXT)
+        {
+            const std::vector<SpriteInstance> &glyphs = hud_text[command.index]->get_glyphs();
+            for (int g = 0; g < (int)glyphs.size(); g++) g_rasteriser.draw_text(hud_text[command.index]->get_texture_id(), glyphs[g]);
+        }
+    }
+}
+
+// The same frame as render draws, rasterised on the CPU and written straight out
+void render_software(const RenderSnapshot &snapshot, float alpha)
+{
+    Uint64 render_start = SDL_GetPerformanceCounter();
+    g_profiler.begin_frame();
+    for (int i = 0; i < PROFILE_RENDER; i++) g_profiler.record(i, snapshot.simulation_milliseconds[i]);
+
+    glm::vec2 camera = snapshot.camera_at(alpha);
+    g_rasteriser.set_matrix(g_projection_matrix * Camera::view_matrix(camera));
+
+    g_background.upload(snapshot.background, &g_rasteriser);
+
+    const TextMesh* hud_text[MAX_HUD_TEXTS];
+    int hud_text_count = gather_hud_text(snapshot, hud_text);
+    queue_commands(snapshot, hud_text, hud_text_count);
+
+    int static_end = g_render_queue.find_layer(LAYER_ACTORS);
+    int scene_end = g_render_queue.find_layer(LAYER_HUD);
+
+    // The rasteriser keeps its own picture of the static sprites
+    if (!g_rasteriser.begin_frame(snapshot.static_hash(camera)))
+    {
+        execute_commands_software(0, static_end, snapshot, hud_text, alpha);
+    }
+    g_rasteriser.end_static();
+
+    execute_commands_software(static_end, scene_end, snapshot, hud_text, alpha);
+
+    g_rasteriser.set_matrix(g_projection_matrix * g_view_matrix);
+    execute_commands_software(scene_end, g_render_queue.get_count(), snapshot, hud_text, alpha);
+
+    g_rasteriser.end_frame();
+    g_frames_rendered++;
+    g_total_sprites_drawn += (int)snapshot.sprites.size();
+    g_total_sprites_culled += snapshot.culled;
+    g_profiler.record(PROFILE_RENDER, milliseconds_since(render_start));
+
+    Uint64 write_start = SDL_GetPerformanceCounter();
+    g_capture.write_frame(g_rasteriser.get_pixels());
+    g_profiler.record(PROFILE_SWAP, milliseconds_since(write_start));
+}
+
+// Runs on whichever thread owns the GL context and reads nothing but the snapshot
+void render(const RenderSnapshot &snapshot)
+{
+    // How far we are between the snapshot's last two steps. Time that passed
+    // since it was published counts too, since the render thread may draw the
+    // same snapshot several times.
+    float since_published = (float)(get_counter() - snapshot.published_at) / SDL_GetPerformanceFrequency();
+    float alpha = (snapshot.accumulator + since_published) / g_fixed_timestep;
+    if (alpha > 1.0f) alpha = 1.0f;
+
+    // Same sprites at the same blend as the frame on screen: nothing to do
+    unsigned long long content = snapshot.content_hash();
+    // (Headless runs must write every frame, changed or not)
+    if (!g_headless && g_frames_rendered > 0 && content == g_drawn_content && (alpha == g_drawn_alpha || snapshot.is_at_rest()))
+    {
+        g_render_pacer.record_skipped_frame();
+        return;
+    }
+    g_drawn_content = content;
+    g_drawn_alpha = alpha;
+
+    if (g_software)
+    {
+        render_software(snapshot, alpha);
+        return;
+    }
+
+    Uint64 render_start = SDL_GetPerformanceCounter();
+    g_profiler.begin_frame();
+    for (int i = 0; i < PROFILE_RENDER; i++) g_profiler.record(i, snapshot.simulation_milliseconds[i]);
+    g_profiler.begin_gpu(PROFILE_GPU_SCENE);
+
+    GLint viewport[4];
+    glGetIntegerv(GL_VIEWPORT, viewport);
+    g_static_layer.set_size(viewport[2], viewport[3]);
+
+    g_background.upload(snapshot.background);
+
+    const TextMesh* hud_text[MAX_HUD_TEXTS];
+    int hud_text_count = gather_hud_text(snapshot, hud_text);
+    queue_commands(snapshot, hud_text, hud_text_count);
+
+    int static_end = g_render_queue.find_layer(LAYER_ACTORS);
+    int scene_end = g_render_queue.find_layer(LAYER_HUD);
+
+    // Uniform uploads switch programs, so they all happen here, before the
+    // batch has anything queued that the wrong program could draw
+    glm::vec2 camera = snapshot.camera_at(alpha);
+    g_batch.flush();
+    g_shaders.get(g_sprite_shader)->set_view_matrix(Camera::view_matrix(camera));
+    if (snapshot.particles.count > 0)
+    {
+        ShaderProgram* particle_program = g_shaders.get(g_particle_shader);
+        particle_program->set_view_matrix(Camera::view_matrix(camera));
+        particle_program->set_colour(1.0f, 1.0f, 1.0f, 1.0f);
+    }
+
+    int particle_draw_calls = 0, particle_vertices = 0;
+
+    // The static sprites are drawn once into a layer, which then replaces
+    // both the clear and every one of their blended quads. While the camera
+    // moves every frame would need a new layer, so none are captured.
+    unsigned long long static_key = snapshot.static_hash(camera);
+    bool camera_still = snapshot.camera == snapshot.previous_camera;
+    if (g_static_layer.is_supported() && camera_still && !g_static_layer.contains(static_key) &&
+        g_static_layer.begin_capture(static_key))
+    {
+        execute_commands(0, static_end, snapshot, hud_text, alpha, false, &particle_draw_calls, &particle_vertices);
+
+        g_batch.flush();
+        g_static_layer.end_capture();
+    }
+
+    if (g_static_layer.contains(static_key))
+    {
+        g_static_layer.composite(static_key);
+    }
+    else
+    {
+        glClear(GL_COLOR_BUFFER_BIT);
+
+        // Nothing is captured while the camera moves, and then the parallax
+        // layers have to follow it between steps
+        execute_commands(0, static_end, snapshot, hud_text, alpha, true, &particle_draw_calls, &particle_vertices);
     }
 
+    execute_commands(static_end, scene_end, snapshot, hud_text, alpha, true, &particle_draw_calls, &particle_vertices);
+
+    g_batch.flush();
+    g_profiler.end_gpu();
+    g_profiler.begin_gpu(PROFILE_GPU_HUD);
+
+    execute_commands(scene_end, g_render_queue.get_count(), snapshot, hud_text, alpha, true, &particle_draw_calls, &particle_vertices);
+
+    g_batch.end_frame();
+    g_profiler.end_gpu();
+
+    g_frames_rendered++;
+    g_total_sprites_drawn += (int)snapshot.sprites.size();
+    g_total_sprites_culled += snapshot.culled;
+    g_total_draw_calls += g_batch.get_stats().draw_calls + particle_draw_calls;
+    g_total_vertices += g_batch.get_stats().vertices + particle_vertices;
+
+    gl_state_end_frame();
+    g_total_gl_calls_issued += gl_state_stats().calls_issued;
+    g_total_gl_calls_skipped += gl_state_stats().calls_skipped;
 
-    SDL_GL_SwapWindow(g_display_window);
+    g_profiler.record(PROFILE_RENDER, milliseconds_since(render_start));
+
+    Uint64 swap_start = SDL_GetPerformanceCounter();
+    if (g_headless) g_capture.capture();
+    else            SDL_GL_SwapWindow(g_display_window);
+    g_profiler.record(PROFILE_SWAP, milliseconds_since(swap_start));
+
+    if (!g_first_frame_presented)
+    {
+        g_first_frame_presented = true;
+        log_startup_phase("first frame (waits on shaders)");
+    }
 }
 
 void shutdown()
 {
+    g_render_pacer.report("render");
+    if (g_use_render_thread) g_simulation_pacer.report("simulation");
+
+    LOG("Profile (mean of the last " << Profiler::HISTORY_FRAMES << " frames, ms):");
+    for (int i = 0; i < PROFILE_SECTION_COUNT; i++)
+    {
+        LOG("  " << profile_section_name(i) << ": " << g_profiler.get_average(i, Profiler::HISTORY_FRAMES));
+    }
+    if (g_profile_csv_filepath != NULL) g_profiler.export_csv(g_profile_csv_filepath);
+
+    if (g_record_filepath != NULL) g_replay.save(g_record_filepath);
+
+    if (g_headless)
+    {
+        g_capture.finish();
+        g_capture.report();
+    }
+
+    if (g_frames_rendered > 0)
+    {
+        LOG("Average per frame: " << (float)g_total_draw_calls / g_frames_rendered << " draw calls, "
+            << (float)g_total_vertices / g_frames_rendered << " vertices");
+        LOG("GL state calls per frame: " << (float)g_total_gl_calls_issued / g_frames_rendered << " issued, "
+            << (float)g_total_gl_calls_skipped / g_frames_rendered << " redundant ones removed");
+        LOG("Sprites per frame: " << (float)g_total_sprites_drawn / g_frames_rendered << " drawn, "
+            << (float)g_total_sprites_culled / g_frames_rendered << " culled off screen");
+        LOG("Particles: " << g_particles.get_peak_count() << " live at most, of " << g_particles.get_capacity());
+        LOG("Background: " << g_background.get_tiles_uploaded() << " tiles streamed into "
+            << g_background.get_page_bytes() / 1024 << " KB of pages");
+        LOG("Render commands per frame: " << (float)g_total_render_commands / g_frames_rendered << ", with "
+            << (float)g_total_program_changes / g_frames_rendered << " program and "
+            << (float)g_total_texture_changes / g_frames_rendered << " texture changes");
+        LOG("Sprite generation: " << g_total_generate_milliseconds / g_frames_rendered << " ms per frame on "
+            << g_render_jobs.get_thread_count() << " threads");
+    }
+
+    g_fuel_text.cleanup();
+    g_parked_text.cleanup();
+    g_crashed_text.cleanup();
+    if (!g_software)
+    {
+        g_batch.cleanup();
+        g_particle_renderer.cleanup();
+        g_static_layer.cleanup();
+        g_shaders.cleanup();
+    }
+    g_render_jobs.cleanup();
+    g_profiler.cleanup();
+    for (int i = 0; i < PROFILE_SECTION_COUNT; i++) g_profiler_text[i].cleanup();
+    g_atlas.cleanup();
+    g_background.cleanup();
+    g_font.cleanup();
+    g_capture.cleanup();
+    g_rasteriser.cleanup();
+    g_particles.cleanup();
+    g_headless_context.cleanup();
+
     SDL_Quit();
 
     delete[] g_state.platforms;
@@ -525,15 +1504,136 @@ void shutdown()
 }
 
 //  GAME LOOP  //
+void render_thread_main()
+{
+    SDL_GL_MakeCurrent(g_display_window, g_context);
+
+    while (g_game_is_running)
+    {
+        // With nothing new we draw the last snapshot again; interpolation
+        // still moves it along between simulation steps
+        g_snapshots.acquire();
+        render(g_snapshots.get_read_slot());
+        g_render_pacer.wait_for_next_frame();
+    }
+
+    SDL_GL_MakeCurrent(g_display_window, NULL);
+}
+
 int main(int argc, char* argv[])
 {
-    initialise();
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--no-render-thread") == 0) g_use_render_thread = false;
+        else if (strcmp(argv[i], "--sim-rate") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0)
+        {
+            g_fixed_timestep = 1.0f / atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc && atoi(argv[i + 1]) >= 0)
+        {
+            g_target_frame_rate = (float)atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--low-power") == 0) g_low_power = true;
+        else if (strcmp(argv[i], "--profile") == 0) g_show_profiler = true;
+        else if (strcmp(argv[i], "--profile-csv") == 0 && i + 1 < argc) g_profile_csv_filepath = argv[++i];
+        else if (strcmp(argv[i], "--headless") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0)
+        {
+            g_headless = true;
+            g_headless_frames = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--capture") == 0 && i + 1 < argc) g_capture_filepath = argv[++i];
+        else if (strcmp(argv[i], "--software") == 0) g_software = true;
+        else if (strcmp(argv[i], "--uncompressed-textures") == 0) g_atlas.set_compression_allowed(false);
+        else if (strcmp(argv[i], "--particle-stress") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0)
+        {
+            g_particle_stress = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--sprite-stress") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0)
+        {
+            g_sprite_stress = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--render-jobs") == 0 && i + 1 < argc && atoi(argv[i + 1]) > 0)
+        {
+            g_render_job_threads = atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--record") == 0 && i + 1 < argc) g_record_filepath = argv[++i];
+        else if (strcmp(argv[i], "--replay") == 0 && i + 1 < argc)
+        {
+            g_playing_replay = g_replay.load(argv[++i]);
+        }
+    }
+
+    // Headless runs draw as fast as they can on their own clock
+    if (g_headless)
+    {
+        if (g_target_frame_rate > 0.0f) g_headless_frame_rate = g_target_frame_rate;
+        g_target_frame_rate = 0.0f;
+        g_use_render_thread = false;
+    }
+    else if (g_software)
+    {
+        LOG("--software only applies to --headless runs; ignoring it");
+        g_software = false;
+    }
+
+    if (!initialise()) return 1;
+
+    // Drawing faster than the simulation only buys smoother interpolation,
+    // which low-power mode is happy to give up
+    float simulation_rate = 1.0f / g_fixed_timestep;
+    if (g_low_power && (g_target_frame_rate == 0.0f || g_target_frame_rate > simulation_rate))
+    {
+        g_target_frame_rate = simulation_rate;
+    }
+    g_render_pacer.initialise(g_target_frame_rate, g_low_power);
+    // The accumulator absorbs any oversleep, so the simulation never spins
+    g_simulation_pacer.initialise(simulation_rate, true);
+
+    // The first snapshot goes out before the render thread starts, so there
+    // is always something to draw
+    publish_snapshot();
+
+    if (g_use_render_thread)
+    {
+        SDL_GL_MakeCurrent(g_display_window, NULL);
+        g_render_thread = std::thread(render_thread_main);
+    }
 
     while (g_game_is_running)
     {
-        process_input();
-        update();
-        render();
+        bool stepped;
+        {
+            ScopedTimer timer(&g_simulation_milliseconds[PROFILE_INPUT]);
+            process_input();
+        }
+        {
+            ScopedTimer timer(&g_simulation_milliseconds[PROFILE_UPDATE]);
+            stepped = update();
+        }
+
+        if (!g_use_render_thread)
+        {
+            publish_snapshot();
+            g_snapshots.acquire();
+            render(g_snapshots.get_read_slot());
+            g_render_pacer.wait_for_next_frame();
+        }
+        else
+        {
+            if (stepped) publish_snapshot();
+
+            // Nothing more to do until the next step is due
+            g_simulation_pacer.wait_for_next_frame();
+        }
+
+        g_frame_number++;
+        if (g_headless && g_frame_number >= g_headless_frames) g_game_is_running = false;
+    }
+
+    if (g_use_render_thread)
+    {
+        g_render_thread.join();
+        SDL_GL_MakeCurrent(g_display_window, g_context);
     }
 
     shutdown();
@@ -0,0 +1,42 @@
+// Every variant is built from this one source; ShaderLibrary prepends a
+// #define for each feature: TEXTURED, TINTED, INSTANCED, SDF_TEXT, ALPHA_TEST,
+// PARTICLE
+#ifdef TEXTURED
+uniform sampler2D diffuse;
+varying vec2 texCoordVar;
+#else
+uniform vec4 color;
+#endif
+
+#ifdef TINTED
+varying vec4 tintVar;
+#endif
+
+void main() {
+#if defined(SDF_TEXT)
+    // .r is the distance to the glyph's fill and .a to its outline's outer
+    // edge; 0.5 is the edge itself (see SdfFont)
+    vec4 field = texture2D(diffuse, texCoordVar);
+
+    // Anti-alias over one screen pixel, whatever size the text is drawn at
+    float smoothing = 0.7 * fwidth(field.a);
+    float fill    = smoothstep(0.5 - smoothing, 0.5 + smoothing, field.r);
+    float outline = smoothstep(0.5 - smoothing, 0.5 + smoothing, field.a);
+
+    vec4 colour = vec4(fill, fill, fill, outline);
+#elif defined(TEXTURED)
+    vec4 colour = texture2D(diffuse, texCoordVar);
+#else
+    vec4 colour = color;
+#endif
+
+#ifdef TINTED
+    colour *= tintVar;
+#endif
+
+#ifdef ALPHA_TEST
+    if (colour.a < 0.5) discard;
+#endif
+
+    gl_FragColor = colour;
+}
@@ -0,0 +1,75 @@
+// Every variant is built from this one source; ShaderLibrary prepends a
+// #define for each feature: TEXTURED, TINTED, INSTANCED, SDF_TEXT, ALPHA_TEST,
+// PARTICLE
+attribute vec4 position;
+
+#if defined(PARTICLE)
+// Per-instance, each from its own array: the particle system's layout goes
+// to the GPU as it is
+attribute float particleX;
+attribute float particleY;
+attribute float particleVelocityX;
+attribute float particleVelocityY;
+attribute float particleSize;
+attribute float particleAlpha;
+uniform float rewind; // seconds to wind every particle back along its velocity
+#elif defined(INSTANCED)
+// Per-instance: one set of these for every sprite
+attribute vec2 spritePosition;
+attribute vec4 spriteBasis;
+attribute vec4 spriteUV;
+#else
+uniform mat4 modelMatrix;
+#ifdef TEXTURED
+attribute vec2 texCoord;
+#endif
+#endif
+
+#ifdef TEXTURED
+varying vec2 texCoordVar;
+#endif
+
+#ifdef TINTED
+attribute vec4 tint;
+varying vec4 tintVar;
+#endif
+
+uniform mat4 viewMatrix;
+uniform mat4 projectionMatrix;
+
+void main()
+{
+#if defined(PARTICLE)
+    vec2 centre = vec2(particleX, particleY) - vec2(particleVelocityX, particleVelocityY) * rewind;
+    vec2 world = centre + position.xy * particleSize;
+
+	gl_Position = projectionMatrix * viewMatrix * vec4(world, 0.0, 1.0);
+#elif defined(INSTANCED)
+    // position is a corner of the shared unit quad; spriteBasis holds the
+    // sprite's x axis in .xy and its y axis in .zw
+    vec2 world = spritePosition + spriteBasis.xy * position.x + spriteBasis.zw * position.y;
+
+#ifdef TEXTURED
+    // spriteUV is (u0, v0, u1, v1) with v0 at the top edge of the sprite
+    texCoordVar = vec2(mix(spriteUV.x, spriteUV.z, position.x + 0.5),
+                       mix(spriteUV.w, spriteUV.y, position.y + 0.5));
+#endif
+
+	gl_Position = projectionMatrix * viewMatrix * vec4(world, 0.0, 1.0);
+#else
+	vec4 p = viewMatrix * modelMatrix  * position;
+
+#ifdef TEXTURED
+    texCoordVar = texCoord;
+#endif
+
+	gl_Position = projectionMatrix * p;
+#endif
+
+#ifdef TINTED
+    tintVar = tint;
+#ifdef PARTICLE
+    tintVar.a *= particleAlpha;
+#endif
+#endif
+}